@@ -0,0 +1,348 @@
+//
+// Created by illfate on 5/12/21.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../vendor/argparse.hpp"
+#include "../cli_runner.h"
+#include "../compiler/compiler.h"
+#include "../compiler/formula_generator.h"
+
+// keep stops the optimizer from dropping a computation whose result is unused.
+template<typename T>
+void keep(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// NullBuffer discards everything written to it, the CLI benchmarks print into it.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+        return count;
+    }
+};
+
+struct BenchResult {
+    std::string name;
+    std::string parameter;
+    size_t iterations = 0;
+    double min_ns = 0;
+    double median_ns = 0;
+    double mean_ns = 0;
+    // items and bytes are the work one iteration does, for the throughput columns
+    uint64_t items = 0;
+    uint64_t bytes = 0;
+
+    double ItemsPerSecond() const {
+        return min_ns > 0 ? double(items) * 1e9 / min_ns : 0;
+    }
+
+    double BytesPerSecond() const {
+        return min_ns > 0 ? double(bytes) * 1e9 / min_ns : 0;
+    }
+};
+
+struct BenchOptions {
+    uint64_t seed = 42;
+    size_t repetitions = 5;
+    // min_batch_ns is the least time one timed batch runs, short benchmarks are repeated
+    // within a batch until they reach it
+    double min_batch_ns = 20e6;
+    uint32_t max_variables = 24;
+    std::string filter;
+};
+
+// Bench runs each benchmark in batches: the number of iterations per batch is doubled
+// until a batch takes min_batch_ns, then repetitions batches are timed and the per
+// iteration times reported. The setup of a benchmark is not timed.
+class Bench {
+public:
+    explicit Bench(BenchOptions options) : options(std::move(options)) {}
+
+    void Run(const std::string &name, const std::string &parameter, uint64_t items, uint64_t bytes,
+             const std::function<void()> &iteration) {
+        std::string full_name = name + "/" + parameter;
+        if (full_name.find(options.filter) == std::string::npos) {
+            return;
+        }
+        std::cerr << "running " << full_name << "\n";
+        size_t batch = 1;
+        while (time(iteration, batch) < options.min_batch_ns && batch < (size_t(1) << 30)) {
+            batch *= 2;
+        }
+        std::vector<double> samples;
+        for (size_t r = 0; r < options.repetitions; ++r) {
+            samples.push_back(time(iteration, batch) / double(batch));
+        }
+        std::ranges::sort(samples);
+        BenchResult result{.name=name, .parameter=parameter, .iterations=batch * samples.size(),
+                .items=items, .bytes=bytes};
+        result.min_ns = samples.front();
+        result.median_ns = samples[samples.size() / 2];
+        for (double sample:samples) {
+            result.mean_ns += sample / double(samples.size());
+        }
+        results.push_back(result);
+    }
+
+    const std::vector<BenchResult> &Results() const {
+        return results;
+    }
+
+    const BenchOptions &Options() const {
+        return options;
+    }
+
+private:
+    static double time(const std::function<void()> &iteration, size_t batch) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            iteration();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    BenchOptions options;
+    std::vector<BenchResult> results;
+};
+
+void benchLexer(Bench &bench, FormulaGenerator &generator) {
+    for (size_t operations:{size_t(1) << 12, size_t(1) << 16}) {
+        std::string formula = generator.Random(MAX_GENERATED_VARIABLES, operations);
+        auto symbol_table = std::make_shared<SymbolTable>();
+        uint64_t tokens = 0;
+        Lexer counter(std::string_view(formula), symbol_table);
+        while (!counter.IsEmpty()) {
+            counter.GetNext();
+            ++tokens;
+        }
+        bench.Run("lexer_get_next", "operations=" + std::to_string(operations), tokens, formula.size(), [&] {
+            Lexer lexer(std::string_view(formula), symbol_table);
+            while (!lexer.IsEmpty()) {
+                keep(lexer.GetNext());
+            }
+        });
+    }
+}
+
+void benchParser(Bench &bench, FormulaGenerator &generator) {
+    auto parse = [](const std::string &formula) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        Parser parser(std::make_unique<Lexer>(std::string_view(formula), symbol_table), symbol_table);
+        parser.build();
+        keep(parser.GetAst().Root());
+    };
+    for (uint32_t levels:{12, 16}) {
+        std::string formula = generator.Wide(MAX_GENERATED_VARIABLES, levels);
+        bench.Run("parser_build_wide", "levels=" + std::to_string(levels), (size_t(1) << levels) - 1,
+                  formula.size(), [&] { parse(formula); });
+    }
+    for (size_t depth:{size_t(1) << 12, size_t(1) << 16}) {
+        std::string formula = generator.Deep(MAX_GENERATED_VARIABLES, depth);
+        bench.Run("parser_build_deep", "depth=" + std::to_string(depth), depth, formula.size(),
+                  [&] { parse(formula); });
+    }
+}
+
+// The analyzer benchmarks parse the formula once outside the timed loop and time the
+// analysis alone, the end to end figures are the cli ones.
+void benchIsPDNF(Bench &bench, FormulaGenerator &generator) {
+    for (auto[variables, minterms]:{std::pair<uint32_t, size_t>{10, 1024}, {16, 8192}, {20, 65536}}) {
+        std::string formula = generator.Pdnf(variables, minterms);
+        auto symbol_table = std::make_shared<SymbolTable>();
+        Parser parser(std::make_unique<Lexer>(std::string_view(formula), symbol_table), symbol_table);
+        parser.build();
+        SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+        bench.Run("analyzer_is_pdnf", "variables=" + std::to_string(variables) + ";minterms=" +
+                                      std::to_string(minterms), minterms, formula.size(), [&] {
+            auto err = analyzer.IsPDNF();
+            keep(err);
+        });
+    }
+}
+
+// benchBatchVerdicts runs BatchCompiler::CheckPDNF over a batch of formulas in PDNF and
+// over batches of the same size that are rejected, by the PDNF check or by the parser at
+// their last character, so that rejecting a formula can be compared with accepting it.
+void benchBatchVerdicts(Bench &bench, FormulaGenerator &generator) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> batches{{"pdnf", {}}, {"not_pdnf", {}},
+                                                                          {"malformed", {}}};
+    while (batches[0].second.size() < 256 || batches[1].second.size() < 256) {
+        std::string formula = generator.PdnfCandidate(8, 32);
+        bool is_pdnf = !Compiler(formula).IsPDNF();
+        auto &batch = batches[is_pdnf ? 0 : 1].second;
+        if (batch.size() < 256) {
+            batch.push_back(formula);
+        }
+        if (is_pdnf && batches[2].second.size() < 256) {
+            batches[2].second.push_back(formula.substr(0, formula.size() - 1));
+        }
+    }
+    BatchCompiler compiler;
+    for (const auto &[name, formulas]:batches) {
+        uint64_t bytes = 0;
+        for (const auto &formula:formulas) {
+            bytes += formula.size();
+        }
+        bench.Run("batch_check_pdnf", "input=" + name, formulas.size(), bytes, [&] {
+            for (const auto &formula:formulas) {
+                keep(compiler.CheckPDNF(formula));
+            }
+        });
+    }
+}
+
+void benchCalculateFormula(Bench &bench, FormulaGenerator &generator) {
+    for (uint32_t variables = 10; variables <= bench.Options().max_variables; variables += 2) {
+        std::string formula = generator.Random(variables, 4 * variables);
+        auto symbol_table = std::make_shared<SymbolTable>();
+        Parser parser(std::make_unique<Lexer>(std::string_view(formula), symbol_table), symbol_table);
+        parser.build();
+        parser.Simplify();
+        SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+        for (auto[engine, engine_name]:{std::pair{Engine::BIT_PARALLEL, "bit-parallel"},
+                                        std::pair{Engine::BDD, "bdd"},
+                                        std::pair{Engine::INTERPRETER, "interpreter"}}) {
+            // the interpreter walks the tree once per row, beyond 16 variables it takes minutes
+            if (engine == Engine::INTERPRETER && variables > 16) {
+                continue;
+            }
+            bench.Run(std::string("analyzer_calculate_formula_") + engine_name,
+                      "variables=" + std::to_string(variables), uint64_t(1) << variables, formula.size(), [&] {
+                        auto result = analyzer.CalculateFormula({.engine=engine});
+                        keep(result);
+                    });
+        }
+    }
+}
+
+void benchCLI(Bench &bench, FormulaGenerator &generator) {
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    for (uint32_t variables:{8, 12, 16}) {
+        std::string formula = generator.Random(variables, 4 * variables);
+        bench.Run("cli_calc", "variables=" + std::to_string(variables), uint64_t(1) << variables, formula.size(),
+                  [&] {
+                      const char *argv[] = {"boolean-expression-compiler", "--formula", formula.c_str(), "--calc"};
+                      CLIRunner runner(std::size(argv), const_cast<char **>(argv));
+                      runner.Run(null_stream);
+                  });
+    }
+}
+
+std::string jsonString(const std::string &value) {
+    std::string escaped = "\"";
+    for (char ch:value) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+        }
+        escaped += ch;
+    }
+    return escaped + "\"";
+}
+
+void writeJson(std::ostream &os, const Bench &bench) {
+    os << std::setprecision(10);
+    os << "{\n  \"context\": {\"seed\": " << bench.Options().seed
+       << ", \"repetitions\": " << bench.Options().repetitions
+       << ", \"kernel\": " << jsonString(selectKernels(Kernel::AUTO).name) << "},\n";
+    os << "  \"benchmarks\": [";
+    for (size_t i = 0; i < bench.Results().size(); ++i) {
+        const auto &result = bench.Results()[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    {\"name\": " << jsonString(result.name)
+           << ", \"parameter\": " << jsonString(result.parameter)
+           << ", \"iterations\": " << result.iterations
+           << ", \"min_ns\": " << result.min_ns
+           << ", \"median_ns\": " << result.median_ns
+           << ", \"mean_ns\": " << result.mean_ns
+           << ", \"items\": " << result.items
+           << ", \"bytes\": " << result.bytes
+           << ", \"items_per_second\": " << result.ItemsPerSecond()
+           << ", \"bytes_per_second\": " << result.BytesPerSecond() << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void writeCsv(std::ostream &os, const Bench &bench) {
+    os << std::setprecision(10);
+    os << "name,parameter,iterations,min_ns,median_ns,mean_ns,items,bytes,items_per_second,bytes_per_second\n";
+    for (const auto &result:bench.Results()) {
+        os << result.name << "," << result.parameter << "," << result.iterations << ","
+           << result.min_ns << "," << result.median_ns << "," << result.mean_ns << ","
+           << result.items << "," << result.bytes << ","
+           << result.ItemsPerSecond() << "," << result.BytesPerSecond() << "\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser cli_parser("bench");
+    cli_parser.add_argument("--format")
+            .help("json (default) or csv").default_value(std::string("json"));
+    cli_parser.add_argument("--filter")
+            .help("run only the benchmarks whose name/parameter contains this").default_value(std::string());
+    cli_parser.add_argument("--seed")
+            .help("seed of the formula generator").default_value(std::string("42"));
+    cli_parser.add_argument("--repetitions")
+            .help("timed batches per benchmark").default_value(std::string("5"));
+    cli_parser.add_argument("--max-variables")
+            .help("largest variable count of the CalculateFormula benchmarks").default_value(std::string("24"));
+    try {
+        cli_parser.parse_args(argc, argv);
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n" << cli_parser;
+        return 1;
+    }
+
+    BenchOptions options;
+    options.seed = std::stoull(cli_parser.get<std::string>("--seed"));
+    options.repetitions = std::max<size_t>(1, std::stoul(cli_parser.get<std::string>("--repetitions")));
+    options.max_variables = std::stoul(cli_parser.get<std::string>("--max-variables"));
+    options.filter = cli_parser.get<std::string>("--filter");
+    std::string format = cli_parser.get<std::string>("--format");
+    if (format != "json" && format != "csv") {
+        std::cerr << "unknown format: " << format << "\n";
+        return 1;
+    }
+
+    Bench bench(options);
+    // every group draws from its own generator, so filtering does not change the formulas
+    FormulaGenerator lexer_generator(options.seed);
+    benchLexer(bench, lexer_generator);
+    FormulaGenerator parser_generator(options.seed + 1);
+    benchParser(bench, parser_generator);
+    FormulaGenerator pdnf_generator(options.seed + 2);
+    benchIsPDNF(bench, pdnf_generator);
+    FormulaGenerator batch_generator(options.seed + 5);
+    benchBatchVerdicts(bench, batch_generator);
+    FormulaGenerator calculate_generator(options.seed + 3);
+    benchCalculateFormula(bench, calculate_generator);
+    FormulaGenerator cli_generator(options.seed + 4);
+    benchCLI(bench, cli_generator);
+
+    if (format == "csv") {
+        writeCsv(std::cout, bench);
+    } else {
+        writeJson(std::cout, bench);
+    }
+}
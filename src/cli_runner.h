@@ -5,11 +5,19 @@
 #ifndef BOOLEAN_EXPRESSION_COMPILER_CLI_RUNNER_H
 #define BOOLEAN_EXPRESSION_COMPILER_CLI_RUNNER_H
 
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <string_view>
 #include <memory>
+#include <utility>
 #include "../vendor/argparse.hpp"
 #include "compiler/compiler.h"
-#include "../vendor/text_table.h"
+#include "compiler/truth_table_file.h"
+#include "server.h"
 
 std::string bool_as_text(bool b) {
 //    std::stringstream converter;
@@ -18,22 +26,51 @@ std::string bool_as_text(bool b) {
     return std::to_string(b);
 }
 
-void formatToTableFormulaResult(const SemanticAnalyzer::FormulaResult &result) {
-    TextTable table('-', '|', '+');
-    for (const auto &symbol:result.symbols) {
-        table.add(symbol);
+// TableStreamWriter prints a truth table in the TextTable('-', '|', '+') layout, but row
+// by row as the rows arrive. The widths are known from the header alone, because every
+// value cell is one character wide.
+class TableStreamWriter {
+public:
+    explicit TableStreamWriter(std::ostream &os) : os(os) {}
+
+    void WriteHeader(const std::vector<std::string> &symbols) {
+        std::vector<std::string> header(symbols.begin(), symbols.end());
+        header.emplace_back("Result");
+        ruler = "+";
+        std::string line = "|";
+        for (const auto &column:header) {
+            widths.push_back(std::max<size_t>(column.size(), 1));
+            ruler.append(widths.back(), '-').append("+");
+            appendCell(line, column, widths.back());
+        }
+        ruler += "\n";
+        os << ruler << line << "\n" << ruler;
     }
-    table.add("Result").endOfRow();
-    size_t counter = 0;
-    for (const auto &row:result.matrix_values) {
+
+    void WriteRow(const std::deque<bool> &row, bool result) {
+        line = "|";
+        size_t column = 0;
         for (bool value:row) {
-            table.add(bool_as_text(value));
+            appendCell(line, bool_as_text(value), widths[column++]);
         }
-        table.add(bool_as_text(result.results[counter])).endOfRow();
-        ++counter;
+        appendCell(line, bool_as_text(result), widths[column]);
+        line += "\n";
+        line += ruler;
+        os << line;
+    }
+
+private:
+    static void appendCell(std::string &line, const std::string &value, size_t width) {
+        line += value;
+        line.append(width - value.size(), ' ');
+        line += "|";
     }
-    std::cout << table;
-}
+
+    std::ostream &os;
+    std::vector<size_t> widths;
+    std::string ruler;
+    std::string line;
+};
 
 class CLIRunner {
 public:
@@ -51,35 +88,160 @@ public:
 
         cli_parser.add_argument(formula_arg)
                 .help("specify a formula string");
+
+        cli_parser.add_argument(engine_arg)
+                .help("specify truth table engine: bit-parallel (default), interpreter or bdd");
+
+        cli_parser.add_argument(bdd_flag).default_value(false)
+                .help("build the formula's bdd and print satisfiability, tautology and model count")
+                .implicit_value(true);
+
+        cli_parser.add_argument(sat_flag).default_value(false)
+                .help("check with the sat solver whether the formula is satisfiable and print a witness")
+                .implicit_value(true);
+
+        cli_parser.add_argument(tautology_flag).default_value(false)
+                .help("check with the sat solver whether the formula is a tautology and print a counterexample")
+                .implicit_value(true);
+
+        cli_parser.add_argument(minimize_flag).default_value(false)
+                .help("print a minimal or near-minimal dnf of the formula").implicit_value(true);
+
+        cli_parser.add_argument(to_pdnf_flag).default_value(false)
+                .help("print the perfect disjunctive normal form of the formula").implicit_value(true);
+
+        cli_parser.add_argument(to_pcnf_flag).default_value(false)
+                .help("print the perfect conjunctive normal form of the formula").implicit_value(true);
+
+        cli_parser.add_argument(equivalent_arg)
+                .help("check whether the formula is equivalent to this formula");
+
+        cli_parser.add_argument(kernel_arg)
+                .help("force bit-parallel kernels: auto (default), scalar, avx2 or avx512");
+
+        cli_parser.add_argument(threads_arg)
+                .help("specify threads for truth table evaluation or batch compilation, 0 uses all cores");
+
+        cli_parser.add_argument(binary_output_arg)
+                .help("write the calculated truth table to a binary file instead of printing it");
+
+        cli_parser.add_argument(batch_arg)
+                .help("compile every line of a file, or of stdin for -, and print one result per line");
+
+        cli_parser.add_argument(serve_arg)
+                .help("serve pdnf and calc requests on a unix socket, --threads sets the workers");
+
+        cli_parser.add_argument(connect_arg)
+                .help("send the --formula or the --batch lines to a server on a unix socket");
+
+        cli_parser.add_argument(cache_size_arg)
+                .help("cache up to this many verdicts and truth tables of parsed formulas in memory");
+
+        cli_parser.add_argument(cache_dir_arg)
+                .help("also store the cache in this directory, so it is shared across runs");
+
+        cli_parser.add_argument(alpha_rename_flag).default_value(false)
+                .help("let cached formulas that only differ in variable names share entries").implicit_value(true);
+
+        cli_parser.add_argument(stats_flag).default_value(false)
+                .help("print phase timings, formula counters, allocations and peak rss to stderr")
+                .implicit_value(true);
+
+        cli_parser.add_argument(stats_format_arg)
+                .help("specify the --stats format: text (default) or json");
     }
 
-    void Run(std::ostream &os) {
-        init();
-        if (is_pdnf && is_pdnf.value()) {
-            if (formula) {
-                processCompilerIsPDNF(std::make_unique<std::stringstream>(formula.value()));
-            } else if (file_name) {
-                auto fstream = std::ifstream();
-                fstream.open(file_name.value());
-                processCompilerIsPDNF(std::make_unique<std::ifstream>(std::move(fstream)));
+    // Run returns the exit status: 1 on a usage error, which is printed with the usage.
+    int Run(std::ostream &os) {
+        try {
+            init();
+        } catch (const std::exception &ex) {
+            std::cerr << ex.what() << "\n" << cli_parser;
+            return 1;
+        }
+        run(os);
+        if (stats) {
+            if (stats_json) {
+                stats->WriteJson(std::cerr);
+            } else {
+                stats->WriteText(std::cerr);
+            }
+        }
+        return 0;
+    }
+
+private:
+    void run(std::ostream &os) {
+        if (serve_path) {
+            serve();
+        } else if (connect_path && ((is_pdnf && is_pdnf.value()) || is_calc_formula)) {
+            connect(os);
+        } else if (batch_input && ((is_pdnf && is_pdnf.value()) || is_calc_formula)) {
+            processBatch(os);
+        } else if (cli_parser[sat_flag] == true || cli_parser[tautology_flag] == true) {
+            if (auto compiler = makeCompiler()) {
+                processCompilerFindRow(os, compiler.value(), cli_parser[sat_flag] == true);
+            }
+        } else if (cli_parser[to_pdnf_flag] == true || cli_parser[to_pcnf_flag] == true) {
+            if (auto compiler = makeCompiler()) {
+                auto form = cli_parser[to_pdnf_flag] == true ? NormalForm::PDNF : NormalForm::PCNF;
+                if (auto err = compiler->StreamNormalForm(os, form, calculate_options)) {
+                    os << err.value() << "\n";
+                } else {
+                    os << "\n";
+                }
+            }
+        } else if (cli_parser[minimize_flag] == true) {
+            if (auto compiler = makeCompiler()) {
+                auto res_var = compiler->Minimize();
+                if (auto cover = std::get_if<Cover>(&res_var)) {
+                    os << cover->Formula() << "\n";
+                } else {
+                    os << std::get<std::string>(res_var) << "\n";
+                }
+            }
+        } else if (cli_parser[bdd_flag] == true) {
+            if (auto compiler = makeCompiler()) {
+                processCompilerBdd(os, compiler.value());
+            }
+        } else if (equivalent_formula) {
+            if (auto compiler = makeCompiler()) {
+                processCompilerIsEquivalent(os, compiler.value());
+            }
+        } else if (is_pdnf && is_pdnf.value()) {
+            if (auto compiler = makeCompiler()) {
+                processCompilerIsPDNF(compiler.value());
             }
         } else if (is_calc_formula) {
-            if (formula) {
-                processCompilerCalculateFormula(std::make_unique<std::stringstream>(formula.value()));
-            } else if (file_name) {
-                auto fstream = std::ifstream();
-                fstream.open(file_name.value());
-                processCompilerCalculateFormula(std::make_unique<std::ifstream>(std::move(fstream)));
+            if (auto compiler = makeCompiler()) {
+                processCompilerCalculateFormula(os, compiler.value());
             }
         } else {
             std::cout << "no arguments were specified\n";
         }
+    }
 
+    // makeCompiler takes the formula from the command line or maps the formula file, so a
+    // large file is lexed in place.
+    std::optional<Compiler> makeCompiler() {
+        std::optional<Compiler> compiler;
+        if (formula) {
+            compiler.emplace(formula.value());
+        } else if (file_name) {
+            try {
+                compiler.emplace(std::make_shared<const MappedFile>(file_name.value()));
+            } catch (const std::exception &ex) {
+                std::cout << ex.what() << "\n";
+            }
+        }
+        if (compiler) {
+            compiler->SetCache(cache);
+            compiler->SetStats(stats);
+        }
+        return compiler;
     }
 
-private:
-    void processCompilerIsPDNF(std::unique_ptr<std::istream> &&is) {
-        Compiler compiler(std::move(is));
+    void processCompilerIsPDNF(Compiler &compiler) {
         auto pdnf_err = compiler.IsPDNF();
         if (pdnf_err) {
             std::cout << "This formula isn't in PDNF: " << pdnf_err.value() << "\n";
@@ -88,16 +250,271 @@ private:
         }
     }
 
-    void processCompilerCalculateFormula(std::unique_ptr<std::istream> &&is) {
-        Compiler compiler(std::move(is));
-        auto res_var = compiler.CalculateFormula();
-        if (auto res = std::get_if<SemanticAnalyzer::FormulaResult>(&res_var)) {
-            formatToTableFormulaResult(*res);
+    void processCompilerBdd(std::ostream &os, Compiler &compiler) {
+        auto res_var = compiler.AnalyzeBdd();
+        auto summary = std::get_if<SemanticAnalyzer::BddSummary>(&res_var);
+        if (!summary) {
+            os << std::get<std::string>(res_var) << "\n";
+            return;
+        }
+        os << "Variables: " << summary->variables.size() << "\n";
+        os << "BDD nodes: " << summary->nodes << "\n";
+        if (summary->witness) {
+            os << "Satisfiable:";
+            for (size_t j = 0; j < summary->variables.size(); ++j) {
+                os << " " << summary->variables[j] << "=" << bool_as_text(summary->witness.value()[j]);
+            }
+            os << "\n";
+        } else {
+            os << "Unsatisfiable\n";
+        }
+        os << "Tautology: " << (summary->tautology ? "yes" : "no") << "\n";
+        os << "Models: " << summary->models << "\n";
+    }
+
+    // processCompilerFindRow answers --sat with a satisfying row and --tautology with a
+    // row that falsifies the formula, if there is one.
+    void processCompilerFindRow(std::ostream &os, Compiler &compiler, bool satisfiable) {
+        auto res_var = compiler.FindRow(satisfiable);
+        auto result = std::get_if<SemanticAnalyzer::SatResult>(&res_var);
+        if (!result) {
+            os << std::get<std::string>(res_var) << "\n";
+            return;
+        }
+        if (satisfiable) {
+            os << (result->witness ? "This formula is satisfiable:" : "This formula is unsatisfiable.");
+        } else {
+            os << (result->witness ? "This formula isn't a tautology:" : "This formula is a tautology.");
+        }
+        if (result->witness) {
+            for (size_t j = 0; j < result->variables.size(); ++j) {
+                os << " " << result->variables[j] << "=" << bool_as_text(result->witness.value()[j]);
+            }
+        }
+        os << "\n";
+    }
+
+    void processCompilerIsEquivalent(std::ostream &os, Compiler &compiler) {
+        auto res_var = compiler.IsEquivalent(equivalent_formula.value());
+        if (auto equivalent = std::get_if<bool>(&res_var)) {
+            os << (*equivalent ? "The formulas are equivalent.\n" : "The formulas aren't equivalent.\n");
         } else {
-            std::cout << std::get<std::string>(res_var);
+            os << std::get<std::string>(res_var) << "\n";
         }
     }
 
+    // processCompilerCalculateFormula streams the table to os, so the rows are never held
+    // in memory all at once, or writes the packed table to the binary output file. With a
+    // cache the packed table is computed, or found, first and printed from there.
+    void processCompilerCalculateFormula(std::ostream &os, Compiler &compiler) {
+        if (cache && !binary_output) {
+            auto res_var = compiler.CalculateFormula(calculate_options);
+            CompileStats::Timer timer(stats.get(), "render");
+            if (auto res = std::get_if<SemanticAnalyzer::FormulaResult>(&res_var)) {
+                TableStreamWriter writer(os);
+                writer.WriteHeader(res->symbols);
+                for (size_t row = 0; row < res->Rows(); ++row) {
+                    writer.WriteRow(res->Row(row), res->results[row]);
+                }
+            } else {
+                os << std::get<std::string>(res_var);
+            }
+            return;
+        }
+        if (binary_output) {
+            // the file is opened first, so a path that can't be written costs no table
+            std::ofstream file(binary_output.value(), std::ios::binary);
+            if (!file) {
+                os << "can't write truth table to " << binary_output.value() << ": " << std::strerror(errno) << "\n";
+                return;
+            }
+            auto res_var = compiler.CalculateFormula(calculate_options);
+            CompileStats::Timer timer(stats.get(), "render");
+            if (auto res = std::get_if<SemanticAnalyzer::FormulaResult>(&res_var)) {
+                try {
+                    writeTruthTable(file, *res);
+                } catch (const std::exception &ex) {
+                    os << ex.what() << " to " << binary_output.value() << "\n";
+                }
+            } else {
+                os << std::get<std::string>(res_var);
+            }
+            return;
+        }
+        TableStreamWriter writer(os);
+        CompileStats::SampledTimer row_timer(stats.get(), "render");
+        auto err = compiler.StreamFormula([&](const std::vector<std::string> &symbols) {
+            CompileStats::Timer timer(stats.get(), "render");
+            writer.WriteHeader(symbols);
+        }, [&](const std::deque<bool> &row, bool result) {
+            row_timer.Time([&] { writer.WriteRow(row, result); });
+        }, calculate_options);
+        if (err) {
+            os << err.value();
+        }
+    }
+
+    // processBatch compiles every line of the batch input and writes one record per line
+    // in input order: "PDNF" or "not PDNF: <reason>" for --pdnf, and for --calc the
+    // columns (bound ones as name=value), a tab and the result column as bits, or
+    // "error: <reason>". The lines are handled a chunk at a time, each chunk is split
+    // between the workers and every worker reuses its own BatchCompiler.
+    void processBatch(std::ostream &os) {
+        constexpr size_t CHUNK_LINES = 4096;
+        ThreadPool pool(calculate_options.threads);
+        std::vector<BatchCompiler> compilers(pool.Size());
+        for (auto &compiler:compilers) {
+            compiler.SetCache(cache);
+        }
+        std::vector<std::string_view> lines;
+        std::vector<std::string> records;
+        auto flush = [&] {
+            records.resize(lines.size());
+            size_t slice = (lines.size() + pool.Size() - 1) / pool.Size();
+            std::vector<std::future<void>> futures;
+            for (size_t task = 0; task * slice < lines.size(); ++task) {
+                futures.push_back(pool.Submit([&, task] {
+                    for (size_t i = task * slice; i < std::min(lines.size(), (task + 1) * slice); ++i) {
+                        records[i] = batchRecord(compilers[task], lines[i], is_pdnf && is_pdnf.value());
+                    }
+                }));
+            }
+            for (auto &future:futures) {
+                future.get();
+            }
+            for (const auto &record:records) {
+                os << record << "\n";
+            }
+            lines.clear();
+        };
+
+        if (batch_input.value() == "-") {
+            std::vector<std::string> chunk(CHUNK_LINES);
+            size_t size = 0;
+            while (std::getline(std::cin, chunk[size])) {
+                if (++size == CHUNK_LINES) {
+                    lines.assign(chunk.begin(), chunk.end());
+                    flush();
+                    size = 0;
+                }
+            }
+            lines.assign(chunk.begin(), chunk.begin() + size);
+            flush();
+            return;
+        }
+        std::optional<MappedFile> file;
+        try {
+            file.emplace(batch_input.value());
+        } catch (const std::exception &ex) {
+            std::cout << ex.what() << "\n";
+            return;
+        }
+        std::string_view input = file->View();
+        while (!input.empty()) {
+            size_t end = std::min(input.find('\n'), input.size());
+            lines.push_back(input.substr(0, end));
+            input.remove_prefix(std::min(end + 1, input.size()));
+            if (lines.size() == CHUNK_LINES) {
+                flush();
+            }
+        }
+        flush();
+    }
+
+    std::string batchRecord(BatchCompiler &compiler, std::string_view line, bool pdnf) const {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (pdnf) {
+            auto pdnf_err = compiler.IsPDNF(line);
+            return pdnf_err ? "not PDNF: " + singleLine(pdnf_err.value()) : "PDNF";
+        }
+        auto options = calculate_options;
+        options.threads = 1;
+        auto res_var = compiler.CalculateFormula(line, options);
+        auto res = std::get_if<SemanticAnalyzer::FormulaResult>(&res_var);
+        if (!res) {
+            return "error: " + singleLine(std::get<std::string>(res_var));
+        }
+        std::string record;
+        for (size_t i = 0; i < res->symbols.size(); ++i) {
+            if (i > 0) {
+                record += ' ';
+            }
+            record += res->symbols[i];
+            if (i < res->bound_values.size()) {
+                record += res->bound_values[i] ? "=1" : "=0";
+            }
+        }
+        record += '\t';
+        for (size_t row = 0; row < res->Rows(); ++row) {
+            record += res->results[row] ? '1' : '0';
+        }
+        return record;
+    }
+
+    // serve answers requests until the process is killed. A request is a line "pdnf " or
+    // "calc " followed by a formula, the answer is its batch record. Every worker thread
+    // keeps its own BatchCompiler. A socket that can't be set up is reported with one
+    // error line.
+    void serve() {
+        try {
+            Server server(serve_path.value(), calculate_options.threads, [this](std::string_view request) {
+                thread_local BatchCompiler compiler;
+                compiler.SetCache(cache);
+                if (request.starts_with(PDNF_REQUEST)) {
+                    return batchRecord(compiler, request.substr(PDNF_REQUEST.size()), true);
+                }
+                if (request.starts_with(CALC_REQUEST)) {
+                    return batchRecord(compiler, request.substr(CALC_REQUEST.size()), false);
+                }
+                return std::string("error: unknown request");
+            });
+            server.Serve();
+        } catch (const std::exception &ex) {
+            std::cout << "error: " << ex.what() << "\n";
+        }
+    }
+
+    // connect sends the formulas to the server and prints the records it answers. A server
+    // that can't be reached or drops the connection ends the output with one error line.
+    void connect(std::ostream &os) {
+        try {
+            Client client(connect_path.value());
+            std::string_view kind = is_pdnf && is_pdnf.value() ? PDNF_REQUEST : CALC_REQUEST;
+            auto request = [&](std::string_view formula) {
+                os << client.Request(std::string(kind) + std::string(formula)) << "\n";
+            };
+            if (formula) {
+                request(formula.value());
+            } else if (batch_input && batch_input.value() == "-") {
+                std::string line;
+                while (std::getline(std::cin, line)) {
+                    request(line);
+                }
+            } else if (batch_input) {
+                MappedFile file(batch_input.value());
+                std::string_view input = file.View();
+                while (!input.empty()) {
+                    size_t end = std::min(input.find('\n'), input.size());
+                    request(input.substr(0, end));
+                    input.remove_prefix(std::min(end + 1, input.size()));
+                }
+            }
+        } catch (const std::exception &ex) {
+            os << "error: " << ex.what() << "\n";
+        }
+    }
+
+    // singleLine keeps an error message on its record's line.
+    static std::string singleLine(std::string message) {
+        while (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        return message;
+    }
+
     void init() {
         cli_parser.parse_args(argc, argv);
         try {
@@ -112,19 +529,111 @@ private:
         }
         catch (const std::exception &exception) {}
 
+        if (auto engine = getOptionalArg(engine_arg)) {
+            if (engine.value() == "interpreter") {
+                calculate_options.engine = Engine::INTERPRETER;
+            } else if (engine.value() == "bit-parallel") {
+                calculate_options.engine = Engine::BIT_PARALLEL;
+            } else if (engine.value() == "bdd") {
+                calculate_options.engine = Engine::BDD;
+            } else {
+                throw std::invalid_argument("unknown engine: " + engine.value());
+            }
+        }
+        if (auto kernel = getOptionalArg(kernel_arg)) {
+            calculate_options.kernel = parseKernel(kernel.value());
+        }
+        if (auto threads = getOptionalArg(threads_arg)) {
+            calculate_options.threads = parseCount(threads_arg, threads.value());
+        }
+        binary_output = getOptionalArg(binary_output_arg);
+        batch_input = getOptionalArg(batch_arg);
+        serve_path = getOptionalArg(serve_arg);
+        connect_path = getOptionalArg(connect_arg);
+        equivalent_formula = getOptionalArg(equivalent_arg);
+        auto cache_size = getOptionalArg(cache_size_arg);
+        auto cache_dir = getOptionalArg(cache_dir_arg);
+        if (cache_size || cache_dir) {
+            CacheOptions cache_options;
+            if (cache_size) {
+                cache_options.capacity = parseCount(cache_size_arg, cache_size.value());
+            }
+            cache_options.directory = cache_dir;
+            cache_options.alpha_rename = cli_parser[alpha_rename_flag] == true;
+            cache = std::make_shared<CompileCache>(cache_options);
+        }
+
+        if (cli_parser[stats_flag] == true) {
+            stats = std::make_shared<CompileStats>();
+            auto format = getOptionalArg(stats_format_arg).value_or("text");
+            if (format != "text" && format != "json") {
+                throw std::invalid_argument("unknown stats format: " + format);
+            }
+            stats_json = format == "json";
+        }
+
         is_pdnf = cli_parser[is_pdnf_flag] == true;
         is_calc_formula = cli_parser[calculate_flag] == true;
     }
 
+    // parseCount reads the value of a numeric flag, which must be a non-negative integer.
+    static size_t parseCount(const std::string &name, const std::string &value) {
+        size_t count = 0;
+        auto[end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+        if (value.empty() || ec != std::errc() || end != value.data() + value.size()) {
+            throw std::invalid_argument(name + " expects a non-negative integer, got: " + value);
+        }
+        return count;
+    }
+
+    std::optional<std::string> getOptionalArg(const std::string &name) {
+        try {
+            return cli_parser.get(name);
+        }
+        catch (const std::exception &exception) {
+            return {};
+        }
+    }
+
     argparse::ArgumentParser cli_parser;
     std::optional<std::string> file_name;
     std::optional<std::string> formula;
     std::optional<bool> is_pdnf;
     bool is_calc_formula;
+    CalculateOptions calculate_options;
+    std::optional<std::string> binary_output;
+    std::optional<std::string> batch_input;
+    std::optional<std::string> serve_path;
+    std::optional<std::string> connect_path;
+    std::optional<std::string> equivalent_formula;
+    std::shared_ptr<CompileCache> cache;
+    std::shared_ptr<CompileStats> stats;
+    bool stats_json = false;
     const std::string file_arg = "--file";
     const std::string formula_arg = "--formula";
     const std::string is_pdnf_flag = "--pdnf";
     const std::string calculate_flag = "--calc";
+    const std::string engine_arg = "--engine";
+    const std::string kernel_arg = "--kernel";
+    const std::string threads_arg = "--threads";
+    const std::string binary_output_arg = "--binary-output";
+    const std::string batch_arg = "--batch";
+    const std::string serve_arg = "--serve";
+    const std::string connect_arg = "--connect";
+    const std::string cache_size_arg = "--cache-size";
+    const std::string cache_dir_arg = "--cache-dir";
+    const std::string alpha_rename_flag = "--alpha-rename";
+    const std::string bdd_flag = "--bdd";
+    const std::string sat_flag = "--sat";
+    const std::string tautology_flag = "--tautology";
+    const std::string equivalent_arg = "--equivalent";
+    const std::string minimize_flag = "--minimize";
+    const std::string to_pdnf_flag = "--to-pdnf";
+    const std::string to_pcnf_flag = "--to-pcnf";
+    const std::string stats_flag = "--stats";
+    const std::string stats_format_arg = "--stats-format";
+    static constexpr std::string_view PDNF_REQUEST = "pdnf ";
+    static constexpr std::string_view CALC_REQUEST = "calc ";
     int argc;
     char **argv;
 };
@@ -0,0 +1,277 @@
+//
+// Created by illfate on 4/18/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_AST_H
+#define BOOLEAN_EXPRESSION_COMPILER_AST_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include "lexer.h"
+#include "non_terminal.h"
+#include "terminal.h"
+
+constexpr uint32_t NO_NODE = UINT32_MAX;
+
+// AstNode is one node of an Ast. The type tag tells how to read the other fields:
+// binary operations use left and right, NOT_OPERATOR keeps its child in left, SYMBOL
+// keeps the interned symbol id in symbol and CONSTANT keeps its value there.
+struct AstNode {
+    TokenType type;
+    uint32_t left = NO_NODE;
+    uint32_t right = NO_NODE;
+    uint32_t symbol = 0;
+
+    bool operator==(const AstNode &other) const = default;
+};
+
+struct AstNodeHash {
+    size_t operator()(const AstNode &node) const {
+        size_t hash = size_t(node.type);
+        hash = hash * 0x9e3779b97f4a7c15 + node.left;
+        hash = hash * 0x9e3779b97f4a7c15 + node.right;
+        hash = hash * 0x9e3779b97f4a7c15 + node.symbol;
+        return hash ^ (hash >> 29);
+    }
+};
+
+// Ast stores all nodes of one compilation in a single arena and links them by 32-bit
+// indices, so building and dropping a tree costs a few vector appends instead of one
+// allocation and refcount per node. Clear keeps the capacity for the next formula.
+//
+// Nodes are hash-consed: adding a node equal to an existing one returns the existing
+// index, so identical subformulas are one node and the arena is a DAG. Children always
+// have smaller indices than their parents.
+//
+// A node may stand for several places of the input, so the source spans are kept per
+// occurrence rather than per node: every node added with a span, which the Parser does
+// in post-order, appends an occurrence with that span. The occurrences unfold the DAG
+// back into the tree as written, with the root last; the nodes the Simplifier adds have
+// no occurrence.
+class Ast {
+public:
+    uint32_t AddSymbol(const std::string &name, std::optional<SourceSpan> span = {}) {
+        auto[it, inserted] = symbol_ids.try_emplace(name, symbols.size());
+        if (inserted) {
+            symbols.push_back(name);
+        }
+        return add({.type=TokenType::SYMBOL, .symbol=it->second}, span);
+    }
+
+    uint32_t AddConstant(bool value, std::optional<SourceSpan> span = {}) {
+        return add({.type=TokenType::CONSTANT, .symbol=value}, span);
+    }
+
+    uint32_t AddNot(uint32_t child, std::optional<SourceSpan> span = {}) {
+        return add({.type=TokenType::NOT_OPERATOR, .left=child}, span);
+    }
+
+    uint32_t AddBinary(TokenType type, uint32_t left, uint32_t right, std::optional<SourceSpan> span = {}) {
+        if (!isBinaryOperation(type)) {
+            throw std::invalid_argument("expected binary operation");
+        }
+        return add({.type=type, .left=left, .right=right}, span);
+    }
+
+    const AstNode &operator[](uint32_t index) const {
+        return nodes[index];
+    }
+
+    // RootOccurrence is the occurrence of the formula as written, NO_NODE if the root was
+    // not added with a span.
+    uint32_t RootOccurrence() const {
+        if (occurrence_nodes.empty() || occurrence_nodes.back() != root) {
+            return NO_NODE;
+        }
+        return occurrence_nodes.size() - 1;
+    }
+
+    size_t Occurrences() const {
+        return occurrence_nodes.size();
+    }
+
+    // NodeOf is the node the occurrence stands for.
+    uint32_t NodeOf(uint32_t occurrence) const {
+        return occurrence_nodes[occurrence];
+    }
+
+    SourceSpan Span(uint32_t occurrence) const {
+        return occurrence == NO_NODE ? SourceSpan{} : occurrence_spans[occurrence];
+    }
+
+    // LeftOccurrence and RightOccurrence are the occurrences of the operands of a binary or
+    // not occurrence, the operand of a not is its left one. In post-order the right
+    // operand comes right before its parent and the left one before the right subtree.
+    uint32_t LeftOccurrence(uint32_t occurrence) const {
+        if (nodes[NodeOf(occurrence)].right == NO_NODE) {
+            return occurrence - 1;
+        }
+        uint32_t right = occurrence - 1;
+        return right - occurrence_sizes[right];
+    }
+
+    uint32_t RightOccurrence(uint32_t occurrence) const {
+        return occurrence - 1;
+    }
+
+    size_t Size() const {
+        return nodes.size();
+    }
+
+    void SetRoot(uint32_t index) {
+        root = index;
+        evaluation_root = NO_NODE;
+    }
+
+    uint32_t Root() const {
+        return root;
+    }
+
+    // SetEvaluationRoot sets an equivalent formula for evaluation, see Simplifier. The
+    // formula at Root stays as written, the structural checks need it.
+    void SetEvaluationRoot(uint32_t index) {
+        evaluation_root = index;
+    }
+
+    uint32_t EvaluationRoot() const {
+        return evaluation_root == NO_NODE ? root : evaluation_root;
+    }
+
+    const std::vector<std::string> &Symbols() const {
+        return symbols;
+    }
+
+    const std::string &Symbol(uint32_t id) const {
+        return symbols[id];
+    }
+
+    std::optional<uint32_t> FindSymbol(const std::string &name) const {
+        auto it = symbol_ids.find(name);
+        if (it == symbol_ids.end()) {
+            return {};
+        }
+        return it->second;
+    }
+
+    void Clear() {
+        nodes.clear();
+        occurrence_nodes.clear();
+        occurrence_sizes.clear();
+        occurrence_spans.clear();
+        node_ids.clear();
+        symbols.clear();
+        symbol_ids.clear();
+        root = NO_NODE;
+        evaluation_root = NO_NODE;
+    }
+
+    // ToExpression materializes the subtree at index as a BooleanExpression tree. The
+    // nodes are built in post-order with an explicit stack, whatever the depth, and a
+    // node shared in the arena is built once and shared in the tree too.
+    std::shared_ptr<BooleanExpression> ToExpression(uint32_t index) const {
+        if (index == NO_NODE) {
+            return nullptr;
+        }
+        std::unordered_map<uint32_t, std::shared_ptr<BooleanExpression>> built;
+        std::vector<std::pair<uint32_t, bool>> stack{{index, false}};
+        while (!stack.empty()) {
+            auto[current, children_built] = stack.back();
+            const auto &node = nodes[current];
+            if (built.contains(current)) {
+                stack.pop_back();
+                continue;
+            }
+            bool leaf = node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT;
+            if (!leaf && !children_built) {
+                stack.back().second = true;
+                if (node.right != NO_NODE) {
+                    stack.emplace_back(node.right, false);
+                }
+                stack.emplace_back(node.left, false);
+                continue;
+            }
+            stack.pop_back();
+            built[current] = makeExpression(node, built);
+        }
+        return built[index];
+    }
+
+private:
+    uint32_t add(const AstNode &node, std::optional<SourceSpan> span) {
+        auto[it, inserted] = node_ids.try_emplace(node, nodes.size());
+        if (inserted) {
+            nodes.push_back(node);
+        }
+        if (span) {
+            uint32_t size = 1;
+            if (node.left != NO_NODE) {
+                uint32_t last = occurrence_sizes.size() - 1;
+                size += occurrence_sizes[last];
+                if (node.right != NO_NODE) {
+                    size += occurrence_sizes[last - occurrence_sizes[last]];
+                }
+            }
+            occurrence_nodes.push_back(it->second);
+            occurrence_sizes.push_back(size);
+            occurrence_spans.push_back(span.value());
+        }
+        return it->second;
+    }
+
+    // makeExpression builds node from the already built expressions of its children.
+    std::shared_ptr<BooleanExpression> makeExpression(
+            const AstNode &node,
+            std::unordered_map<uint32_t, std::shared_ptr<BooleanExpression>> &built) const {
+        switch (node.type) {
+            case TokenType::SYMBOL:
+                return std::make_shared<Terminal>(symbols[node.symbol]);
+            case TokenType::CONSTANT:
+                return std::make_shared<Constant>(node.symbol ? "1" : "0");
+            case TokenType::NOT_OPERATOR: {
+                auto not_op = std::make_shared<NotOperation>();
+                not_op->SetChild(built[node.left]);
+                return not_op;
+            }
+            case TokenType::AND_OPERATOR:
+                return makeBinary<AndOperation>(node, built);
+            case TokenType::OR_OPERATOR:
+                return makeBinary<OrOperation>(node, built);
+            case TokenType::IMPLICATION:
+                return makeBinary<ImplicationOperation>(node, built);
+            case TokenType::EQUALITY:
+                return makeBinary<EqualityOperation>(node, built);
+            default:
+                throw std::invalid_argument("unexpected node in formula");
+        }
+    }
+
+    template<typename Operation>
+    static std::shared_ptr<BooleanExpression> makeBinary(
+            const AstNode &node,
+            std::unordered_map<uint32_t, std::shared_ptr<BooleanExpression>> &built) {
+        auto operation = std::make_shared<Operation>();
+        operation->SetLeft(built[node.left]);
+        operation->SetRight(built[node.right]);
+        return operation;
+    }
+
+    std::vector<AstNode> nodes;
+    // an occurrence is one place of the input a node stands for, its size counts the
+    // occurrences of its subtree, itself included; the walks only read node and size
+    std::vector<uint32_t> occurrence_nodes;
+    std::vector<uint32_t> occurrence_sizes;
+    std::vector<SourceSpan> occurrence_spans;
+    std::unordered_map<AstNode, uint32_t, AstNodeHash> node_ids;
+    std::vector<std::string> symbols;
+    std::unordered_map<std::string, uint32_t> symbol_ids;
+    uint32_t root = NO_NODE;
+    uint32_t evaluation_root = NO_NODE;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_AST_H
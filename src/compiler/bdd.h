@@ -0,0 +1,298 @@
+//
+// Created by illfate on 5/4/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_BDD_H
+#define BOOLEAN_EXPRESSION_COMPILER_BDD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ast.h"
+#include "bit_vector.h"
+#include "row_patterns.h"
+
+using BddRef = uint32_t;
+
+constexpr BddRef BDD_FALSE = 0;
+constexpr BddRef BDD_TRUE = 1;
+
+struct BddNode {
+    uint32_t var;
+    BddRef low;
+    BddRef high;
+
+    bool operator==(const BddNode &other) const = default;
+};
+
+struct BddNodeHash {
+    size_t operator()(const BddNode &node) const {
+        size_t hash = node.var;
+        hash = hash * 0x9e3779b97f4a7c15 + node.low;
+        hash = hash * 0x9e3779b97f4a7c15 + node.high;
+        return hash ^ (hash >> 29);
+    }
+};
+
+// BddManager owns reduced ordered BDDs over variables 0..variables-1. Variable j is
+// bit j of a truth table row, and the highest variable is tested first, so the two
+// cofactors of a node cover the lower and the upper half of its rows. Nodes are unique
+// through the unique table, so equal functions have equal references; ITE results are
+// memoized in a direct-mapped computed cache.
+class BddManager {
+public:
+    static constexpr size_t CACHE_SIZE = size_t(1) << 16;
+
+    explicit BddManager(uint32_t variables) : variables(variables), cache(CACHE_SIZE) {
+        if (variables >= 64) {
+            throw std::invalid_argument("too many variables for a bdd: " + std::to_string(variables));
+        }
+        nodes.push_back({TERMINAL_VAR, BDD_FALSE, BDD_FALSE});
+        nodes.push_back({TERMINAL_VAR, BDD_TRUE, BDD_TRUE});
+    }
+
+    uint32_t Variables() const {
+        return variables;
+    }
+
+    size_t Size() const {
+        return nodes.size();
+    }
+
+    BddRef Var(uint32_t var) {
+        if (var >= variables) {
+            throw std::invalid_argument("unknown bdd variable: " + std::to_string(var));
+        }
+        return makeNode(var, BDD_FALSE, BDD_TRUE);
+    }
+
+    BddRef Not(BddRef f) {
+        return Ite(f, BDD_FALSE, BDD_TRUE);
+    }
+
+    BddRef And(BddRef f, BddRef g) {
+        return Ite(f, g, BDD_FALSE);
+    }
+
+    BddRef Or(BddRef f, BddRef g) {
+        return Ite(f, BDD_TRUE, g);
+    }
+
+    BddRef Implication(BddRef f, BddRef g) {
+        return Ite(f, g, BDD_TRUE);
+    }
+
+    BddRef Equality(BddRef f, BddRef g) {
+        return Ite(f, g, Not(g));
+    }
+
+    // Ite returns (f /\ g) \/ (!f /\ h). The recursion depth is bounded by the number of
+    // variables.
+    BddRef Ite(BddRef f, BddRef g, BddRef h) {
+        if (f == BDD_TRUE) {
+            return g;
+        }
+        if (f == BDD_FALSE) {
+            return h;
+        }
+        if (g == h) {
+            return g;
+        }
+        if (g == BDD_TRUE && h == BDD_FALSE) {
+            return f;
+        }
+        auto &entry = cache[cacheSlot(f, g, h)];
+        if (entry.valid && entry.f == f && entry.g == g && entry.h == h) {
+            return entry.result;
+        }
+        uint32_t top = std::max({level(f), level(g), level(h)});
+        BddRef low = Ite(cofactor(f, top, false), cofactor(g, top, false), cofactor(h, top, false));
+        BddRef high = Ite(cofactor(f, top, true), cofactor(g, top, true), cofactor(h, top, true));
+        BddRef result = makeNode(top - 1, low, high);
+        // the recursive calls may have reused the slot
+        cache[cacheSlot(f, g, h)] = {true, f, g, h, result};
+        return result;
+    }
+
+    const BddNode &operator[](BddRef f) const {
+        return nodes[f];
+    }
+
+    // ModelCount returns the number of assignments of all variables that satisfy f.
+    uint64_t ModelCount(BddRef f) const {
+        std::unordered_map<BddRef, uint64_t> counts;
+        return countBelow(f, counts) << (variables - level(f));
+    }
+
+    // AnyModel returns a satisfying assignment of f, the variables f does not test are
+    // false.
+    std::optional<std::vector<bool>> AnyModel(BddRef f) const {
+        if (f == BDD_FALSE) {
+            return {};
+        }
+        std::vector<bool> model(variables);
+        while (f != BDD_TRUE) {
+            const auto &node = nodes[f];
+            model[node.var] = node.high != BDD_FALSE;
+            f = model[node.var] ? node.high : node.low;
+        }
+        return model;
+    }
+
+    // TruthTable expands f into its 2^variables rows.
+    BitVector TruthTable(BddRef f) const {
+        size_t rows = size_t(1) << variables;
+        std::vector<uint64_t> words(wordsForRows(rows));
+        fillRows(f, variables, words.data());
+        return {std::move(words), rows};
+    }
+
+private:
+    static constexpr uint32_t TERMINAL_VAR = UINT32_MAX;
+
+    struct CacheEntry {
+        bool valid = false;
+        BddRef f = 0;
+        BddRef g = 0;
+        BddRef h = 0;
+        BddRef result = 0;
+    };
+
+    static size_t cacheSlot(BddRef f, BddRef g, BddRef h) {
+        uint64_t hash = (uint64_t(f) * 0x9e3779b97f4a7c15) ^ (uint64_t(g) * 0xbf58476d1ce4e5b9) ^
+                        (uint64_t(h) * 0x94d049bb133111eb);
+        return (hash ^ (hash >> 32)) & (CACHE_SIZE - 1);
+    }
+
+    BddRef makeNode(uint32_t var, BddRef low, BddRef high) {
+        if (low == high) {
+            return low;
+        }
+        BddNode node{var, low, high};
+        auto[it, inserted] = unique.try_emplace(node, nodes.size());
+        if (inserted) {
+            nodes.push_back(node);
+        }
+        return it->second;
+    }
+
+    // level is the variable f tests first plus one, 0 for the terminals: the number of
+    // variables f may depend on.
+    uint32_t level(BddRef f) const {
+        return f <= BDD_TRUE ? 0 : nodes[f].var + 1;
+    }
+
+    BddRef cofactor(BddRef f, uint32_t top, bool value) const {
+        if (level(f) != top) {
+            return f;
+        }
+        return value ? nodes[f].high : nodes[f].low;
+    }
+
+    // countBelow counts the models of f over the variables below its top variable and
+    // the top variable itself.
+    uint64_t countBelow(BddRef f, std::unordered_map<BddRef, uint64_t> &counts) const {
+        if (f <= BDD_TRUE) {
+            return f;
+        }
+        if (auto it = counts.find(f); it != counts.end()) {
+            return it->second;
+        }
+        const auto &node = nodes[f];
+        uint64_t count = (countBelow(node.low, counts) << (node.var - level(node.low))) +
+                         (countBelow(node.high, counts) << (node.var - level(node.high)));
+        counts[f] = count;
+        return count;
+    }
+
+    // fillRows writes the rows of f over variables 0..k-1 to words. Below 64 rows the
+    // rows are combined from the row patterns of the low variables.
+    void fillRows(BddRef f, uint32_t k, uint64_t *words) const {
+        if (k <= LOW_VARIABLES) {
+            uint64_t mask = k == LOW_VARIABLES ? ~uint64_t(0) : (uint64_t(1) << (size_t(1) << k)) - 1;
+            words[0] = lowWord(f) & mask;
+            return;
+        }
+        size_t half = wordsForRows(size_t(1) << (k - 1));
+        if (level(f) < k) {
+            fillRows(f, k - 1, words);
+            std::copy(words, words + half, words + half);
+            return;
+        }
+        fillRows(nodes[f].low, k - 1, words);
+        fillRows(nodes[f].high, k - 1, words + half);
+    }
+
+    uint64_t lowWord(BddRef f) const {
+        if (f <= BDD_TRUE) {
+            return f == BDD_TRUE ? ~uint64_t(0) : 0;
+        }
+        const auto &node = nodes[f];
+        uint64_t pattern = LOW_VARIABLE_PATTERNS[node.var];
+        return (~pattern & lowWord(node.low)) | (pattern & lowWord(node.high));
+    }
+
+    uint32_t variables;
+    std::vector<BddNode> nodes;
+    std::unordered_map<BddNode, BddRef, BddNodeHash> unique;
+    std::vector<CacheEntry> cache;
+};
+
+// buildBdd builds the formula at root in manager, in post-order over the DAG with an
+// explicit stack. symbol_bdds gives the function of every symbol id.
+BddRef buildBdd(BddManager &manager, const Ast &ast, uint32_t root, const std::vector<BddRef> &symbol_bdds) {
+    std::unordered_map<uint32_t, BddRef> built;
+    std::vector<std::pair<uint32_t, bool>> stack{{root, false}};
+    while (!stack.empty()) {
+        auto[index, children_built] = stack.back();
+        const auto &node = ast[index];
+        if (built.contains(index)) {
+            stack.pop_back();
+            continue;
+        }
+        bool leaf = node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT;
+        if (!leaf && !children_built) {
+            stack.back().second = true;
+            if (node.right != NO_NODE) {
+                stack.emplace_back(node.right, false);
+            }
+            stack.emplace_back(node.left, false);
+            continue;
+        }
+        stack.pop_back();
+        BddRef f;
+        switch (node.type) {
+            case TokenType::SYMBOL:
+                f = symbol_bdds[node.symbol];
+                break;
+            case TokenType::CONSTANT:
+                f = node.symbol ? BDD_TRUE : BDD_FALSE;
+                break;
+            case TokenType::NOT_OPERATOR:
+                f = manager.Not(built[node.left]);
+                break;
+            case TokenType::AND_OPERATOR:
+                f = manager.And(built[node.left], built[node.right]);
+                break;
+            case TokenType::OR_OPERATOR:
+                f = manager.Or(built[node.left], built[node.right]);
+                break;
+            case TokenType::IMPLICATION:
+                f = manager.Implication(built[node.left], built[node.right]);
+                break;
+            case TokenType::EQUALITY:
+                f = manager.Equality(built[node.left], built[node.right]);
+                break;
+            default:
+                throw std::invalid_argument("unexpected node in formula");
+        }
+        built[index] = f;
+    }
+    return built[root];
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_BDD_H
@@ -0,0 +1,82 @@
+//
+// Created by illfate on 4/26/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_BIT_VECTOR_H
+#define BOOLEAN_EXPRESSION_COMPILER_BIT_VECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include <initializer_list>
+#include <utility>
+#include <ostream>
+#include "row_patterns.h"
+
+// BitVector stores one bit per row packed into 64-bit words, bit i of the vector is bit
+// i % 64 of word i / 64, the layout the bit-parallel engine produces.
+class BitVector {
+public:
+    BitVector() = default;
+
+    BitVector(std::vector<uint64_t> words, size_t size) : words(std::move(words)), size(size) {
+        this->words.resize(wordsForRows(size));
+        clearTail();
+    }
+
+    BitVector(std::initializer_list<bool> bits) : BitVector(bits.begin(), bits.end()) {}
+
+    template<typename It>
+    BitVector(It begin, It end) {
+        for (auto it = begin; it != end; ++it) {
+            PushBack(*it);
+        }
+    }
+
+    bool operator[](size_t index) const {
+        return (words[index / ROWS_PER_WORD] >> (index % ROWS_PER_WORD)) & 1;
+    }
+
+    void PushBack(bool bit) {
+        if (size % ROWS_PER_WORD == 0) {
+            words.push_back(0);
+        }
+        words.back() |= uint64_t(bit) << (size % ROWS_PER_WORD);
+        ++size;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+
+    const std::vector<uint64_t> &Words() const {
+        return words;
+    }
+
+    bool operator==(const BitVector &other) const {
+        return size == other.size && words == other.words;
+    }
+
+    bool operator!=(const BitVector &other) const {
+        return !(*this == other);
+    }
+
+private:
+    // clearTail zeroes the bits past size, so equal vectors have equal words.
+    void clearTail() {
+        if (size % ROWS_PER_WORD != 0) {
+            words.back() &= (uint64_t(1) << (size % ROWS_PER_WORD)) - 1;
+        }
+    }
+
+    std::vector<uint64_t> words;
+    size_t size = 0;
+};
+
+std::ostream &operator<<(std::ostream &os, const BitVector &bits) {
+    for (size_t i = 0; i < bits.Size(); ++i) {
+        os << bits[i];
+    }
+    return os;
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_BIT_VECTOR_H
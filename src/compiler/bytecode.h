@@ -0,0 +1,374 @@
+//
+// Created by illfate on 4/14/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_BYTECODE_H
+#define BOOLEAN_EXPRESSION_COMPILER_BYTECODE_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <ostream>
+#include <functional>
+#include "ast.h"
+#include "kernels.h"
+#include "row_patterns.h"
+#include "thread_pool.h"
+
+enum class OpCode : uint8_t {
+    NOT,
+    AND,
+    OR,
+    IMPLICATION,
+    EQUALITY,
+};
+
+// Instruction is a three-address operation over registers, every register holds one
+// block of rows. rhs is unused by NOT.
+struct Instruction {
+    OpCode op;
+    uint32_t dst;
+    uint32_t lhs;
+    uint32_t rhs;
+};
+
+// Program is a formula lowered to a flat instruction array. Registers are laid out as
+// [variables..., FALSE, TRUE, temporaries...], so variables and constants are read
+// in place and only operations write registers.
+struct Program {
+    std::vector<Instruction> code;
+    uint32_t variables = 0;
+    uint32_t registers = 0;
+    uint32_t result = 0;
+
+    uint32_t FalseRegister() const { return variables; }
+
+    uint32_t TrueRegister() const { return variables + 1; }
+};
+
+std::ostream &operator<<(std::ostream &os, const OpCode &op) {
+    switch (op) {
+        case OpCode::NOT:
+            os << "not";
+            return os;
+        case OpCode::AND:
+            os << "and";
+            return os;
+        case OpCode::OR:
+            os << "or";
+            return os;
+        case OpCode::IMPLICATION:
+            os << "implication";
+            return os;
+        case OpCode::EQUALITY:
+            os << "equality";
+            return os;
+    }
+    return os;
+}
+
+std::ostream &operator<<(std::ostream &os, const Program &program) {
+    for (const auto &instruction:program.code) {
+        os << "r" << instruction.dst << " = " << instruction.op << " r" << instruction.lhs;
+        if (instruction.op != OpCode::NOT) {
+            os << ", r" << instruction.rhs;
+        }
+        os << "\n";
+    }
+    os << "result r" << program.result << "\n";
+    return os;
+}
+
+// BytecodeCompiler lowers an Ast in post-order. symbol_registers maps every symbol id
+// either to its variable register or, for symbols bound by let, to a constant
+// register. A node shared in the DAG is lowered once and keeps its register until its
+// last parent is lowered; other temporaries are recycled as soon as the parent
+// consumes them, so the register count stays bounded by the tree depth plus the live
+// shared nodes.
+class BytecodeCompiler {
+public:
+    BytecodeCompiler(const Ast &ast, const std::vector<uint32_t> &symbol_registers, uint32_t variables)
+            : ast(ast), symbol_registers(symbol_registers) {
+        program.variables = variables;
+        program.registers = program.variables + 2;
+    }
+
+    Program Compile(uint32_t root) {
+        countUses(root);
+        program.result = lower(root);
+        return program;
+    }
+
+private:
+    // countUses counts the parents of every node reachable from root, root counts its
+    // result as one more.
+    void countUses(uint32_t root) {
+        uses.assign(ast.Size(), 0);
+        std::vector<bool> visited(ast.Size());
+        std::vector<uint32_t> stack{root};
+        visited[root] = true;
+        ++uses[root];
+        while (!stack.empty()) {
+            const auto &node = ast[stack.back()];
+            stack.pop_back();
+            if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+                continue;
+            }
+            for (uint32_t child:{node.left, node.right}) {
+                if (child == NO_NODE) {
+                    continue;
+                }
+                ++uses[child];
+                if (!visited[child]) {
+                    visited[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+
+    // lower walks the DAG in post-order with an explicit stack. operands holds the nodes
+    // lowered whose parent is not lowered yet, lowered the register of every node
+    // lowered so far.
+    uint32_t lower(uint32_t root) {
+        lowered.assign(ast.Size(), NO_NODE);
+        std::vector<std::pair<uint32_t, bool>> stack{{root, false}};
+        std::vector<uint32_t> operands;
+        while (!stack.empty()) {
+            auto[index, children_lowered] = stack.back();
+            const auto &node = ast[index];
+            if (lowered[index] != NO_NODE) {
+                operands.push_back(index);
+                stack.pop_back();
+                continue;
+            }
+            switch (node.type) {
+                case TokenType::SYMBOL:
+                    lowered[index] = symbol_registers[node.symbol];
+                    break;
+                case TokenType::CONSTANT:
+                    lowered[index] = node.symbol ? program.TrueRegister() : program.FalseRegister();
+                    break;
+                case TokenType::NOT_OPERATOR:
+                case TokenType::AND_OPERATOR:
+                case TokenType::OR_OPERATOR:
+                case TokenType::IMPLICATION:
+                case TokenType::EQUALITY:
+                    if (!children_lowered) {
+                        stack.back().second = true;
+                        if (node.type != TokenType::NOT_OPERATOR) {
+                            stack.emplace_back(node.right, false);
+                        }
+                        stack.emplace_back(node.left, false);
+                        continue;
+                    }
+                    lowered[index] = lowerOperation(node, operands);
+                    break;
+                default:
+                    throw std::invalid_argument("unexpected node in formula");
+            }
+            operands.push_back(index);
+            stack.pop_back();
+        }
+        return lowered[root];
+    }
+
+    // lowerOperation emits node, its operands are on the back of operands.
+    uint32_t lowerOperation(const AstNode &node, std::vector<uint32_t> &operands) {
+        if (node.type == TokenType::NOT_OPERATOR) {
+            uint32_t child = consume(operands);
+            uint32_t dst = acquire();
+            program.code.push_back({OpCode::NOT, dst, child, 0});
+            return dst;
+        }
+        uint32_t rhs = consume(operands);
+        uint32_t lhs = consume(operands);
+        uint32_t dst = acquire();
+        program.code.push_back({opCode(node.type), dst, lhs, rhs});
+        return dst;
+    }
+
+    static OpCode opCode(TokenType type) {
+        switch (type) {
+            case TokenType::AND_OPERATOR:
+                return OpCode::AND;
+            case TokenType::OR_OPERATOR:
+                return OpCode::OR;
+            case TokenType::IMPLICATION:
+                return OpCode::IMPLICATION;
+            default:
+                return OpCode::EQUALITY;
+        }
+    }
+
+    // consume pops an operand and releases its register after its last use.
+    uint32_t consume(std::vector<uint32_t> &operands) {
+        uint32_t index = operands.back();
+        operands.pop_back();
+        if (--uses[index] == 0) {
+            release(lowered[index]);
+        }
+        return lowered[index];
+    }
+
+    uint32_t acquire() {
+        if (!free_registers.empty()) {
+            uint32_t reg = free_registers.back();
+            free_registers.pop_back();
+            return reg;
+        }
+        return program.registers++;
+    }
+
+    void release(uint32_t reg) {
+        if (reg > program.TrueRegister()) {
+            free_registers.push_back(reg);
+        }
+    }
+
+    const Ast &ast;
+    const std::vector<uint32_t> &symbol_registers;
+    std::vector<uint32_t> uses;
+    std::vector<uint32_t> lowered;
+    std::vector<uint32_t> free_registers;
+    Program program;
+};
+
+// VirtualMachine runs a Program over the truth table of its variables, one block of
+// BLOCK_WORDS words per pass. Variables below LOW_BLOCK_VARIABLES vary inside a block,
+// so their registers are filled once; the others are uniform over a block and are
+// refilled when a block is selected.
+class VirtualMachine {
+public:
+    static constexpr size_t LOW_BLOCK_VARIABLES = 12; // 6 + log2(BLOCK_WORDS)
+
+    VirtualMachine(const Program &program, const WordKernels &kernels)
+            : program(program), kernels(kernels), memory(size_t(program.registers) * BLOCK_WORDS),
+              rows(size_t(1) << program.variables) {
+        for (size_t j = 0; j < program.variables && j < LOW_BLOCK_VARIABLES; ++j) {
+            for (size_t w = 0; w < BLOCK_WORDS; ++w) {
+                reg(j)[w] = rowPattern(j, w);
+            }
+        }
+        kernels.fill(reg(program.FalseRegister()), 0, BLOCK_WORDS);
+        kernels.fill(reg(program.TrueRegister()), ~uint64_t(0), BLOCK_WORDS);
+    }
+
+    size_t Rows() const {
+        return rows;
+    }
+
+    size_t Blocks() const {
+        return (wordsForRows(rows) + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    }
+
+    // Run evaluates the given block and returns its result words, valid until the next
+    // call. words receives the number of meaningful words in the block.
+    const uint64_t *Run(size_t block, size_t &words) {
+        words = std::min(BLOCK_WORDS, wordsForRows(rows) - block * BLOCK_WORDS);
+        for (size_t j = LOW_BLOCK_VARIABLES; j < program.variables; ++j) {
+            kernels.fill(reg(j), rowPattern(j, block * BLOCK_WORDS), words);
+        }
+        for (const auto &instruction:program.code) {
+            uint64_t *dst = reg(instruction.dst);
+            const uint64_t *lhs = reg(instruction.lhs);
+            const uint64_t *rhs = reg(instruction.rhs);
+            switch (instruction.op) {
+                case OpCode::NOT:
+                    kernels.not_op(dst, lhs, words);
+                    break;
+                case OpCode::AND:
+                    kernels.and_op(dst, lhs, rhs, words);
+                    break;
+                case OpCode::OR:
+                    kernels.or_op(dst, lhs, rhs, words);
+                    break;
+                case OpCode::IMPLICATION:
+                    kernels.implication_op(dst, lhs, rhs, words);
+                    break;
+                case OpCode::EQUALITY:
+                    kernels.equality_op(dst, lhs, rhs, words);
+                    break;
+            }
+        }
+        return reg(program.result);
+    }
+
+private:
+    uint64_t *reg(uint32_t index) {
+        return memory.data() + size_t(index) * BLOCK_WORDS;
+    }
+
+    const Program &program;
+    const WordKernels &kernels;
+    std::vector<uint64_t> memory;
+    size_t rows;
+};
+
+using BlockCallback = std::function<void(size_t first_row, const uint64_t *words, size_t rows)>;
+
+// streamProgram evaluates program and hands the result words of every block to on_block
+// in row order. With more than one thread the blocks are evaluated a window at a time:
+// each worker runs a few consecutive blocks of the window on its own VirtualMachine,
+// then the window is emitted in order. Memory stays bounded whatever the row count.
+void streamProgram(const Program &program, const WordKernels &kernels, size_t threads,
+                   const BlockCallback &on_block) {
+    size_t rows = size_t(1) << program.variables;
+    size_t blocks = (wordsForRows(rows) + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    auto block_rows = [&](size_t block) {
+        return std::min(BLOCK_WORDS * ROWS_PER_WORD, rows - block * BLOCK_WORDS * ROWS_PER_WORD);
+    };
+    if (threads == 1 || blocks == 1) {
+        VirtualMachine vm(program, kernels);
+        for (size_t block = 0; block < blocks; ++block) {
+            size_t words;
+            const uint64_t *result = vm.Run(block, words);
+            on_block(block * BLOCK_WORDS * ROWS_PER_WORD, result, block_rows(block));
+        }
+        return;
+    }
+
+    ThreadPool pool(threads);
+    constexpr size_t BLOCKS_PER_TASK = 4;
+    size_t window = pool.Size() * BLOCKS_PER_TASK;
+    std::vector<VirtualMachine> vms;
+    for (size_t i = 0; i < pool.Size(); ++i) {
+        vms.emplace_back(program, kernels);
+    }
+    std::vector<uint64_t> buffer(window * BLOCK_WORDS);
+    for (size_t first_block = 0; first_block < blocks; first_block += window) {
+        size_t last_block = std::min(blocks, first_block + window);
+        std::vector<std::future<void>> futures;
+        for (size_t task = 0; first_block + task * BLOCKS_PER_TASK < last_block; ++task) {
+            futures.push_back(pool.Submit([&, task] {
+                size_t first = first_block + task * BLOCKS_PER_TASK;
+                size_t last = std::min(last_block, first + BLOCKS_PER_TASK);
+                for (size_t block = first; block < last; ++block) {
+                    size_t words;
+                    const uint64_t *result = vms[task].Run(block, words);
+                    kernels.copy(&buffer[(block - first_block) * BLOCK_WORDS], result, words);
+                }
+            }));
+        }
+        for (auto &future:futures) {
+            future.get();
+        }
+        for (size_t block = first_block; block < last_block; ++block) {
+            on_block(block * BLOCK_WORDS * ROWS_PER_WORD, &buffer[(block - first_block) * BLOCK_WORDS],
+                     block_rows(block));
+        }
+    }
+}
+
+// evaluateProgram returns the whole result column of program, one row per bit.
+std::vector<uint64_t> evaluateProgram(const Program &program, const WordKernels &kernels, size_t threads = 1) {
+    std::vector<uint64_t> result(wordsForRows(size_t(1) << program.variables));
+    streamProgram(program, kernels, threads, [&](size_t first_row, const uint64_t *words, size_t rows) {
+        kernels.copy(&result[first_row / ROWS_PER_WORD], words, wordsForRows(rows));
+    });
+    return result;
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_BYTECODE_H
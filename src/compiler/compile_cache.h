@@ -0,0 +1,385 @@
+//
+// Created by illfate on 5/2/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_COMPILE_CACHE_H
+#define BOOLEAN_EXPRESSION_COMPILER_COMPILE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "symbol_table.h"
+#include "semantic_analyzer.h"
+#include "truth_table_file.h"
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    x ^= x >> 31;
+    return x;
+}
+
+// fnv1a hashes a symbol name the same way in every run, unlike std::hash.
+uint64_t fnv1a(const std::string &str) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char ch:str) {
+        hash = (hash ^ uint8_t(ch)) * 0x100000001b3;
+    }
+    return hash;
+}
+
+// CacheKey is a 128-bit hash of a parsed formula, two independently mixed lanes.
+struct CacheKey {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    void Mix(uint64_t value) {
+        high = mix64(high ^ value);
+        low = mix64(low + value + 0x9e3779b97f4a7c15);
+    }
+
+    bool operator==(const CacheKey &other) const = default;
+
+    std::string Hex() const {
+        std::ostringstream os;
+        os << std::hex;
+        os.width(16);
+        os.fill('0');
+        os << high;
+        os.width(16);
+        os << low;
+        return os.str();
+    }
+};
+
+struct CacheKeyHash {
+    size_t operator()(const CacheKey &key) const {
+        return key.high ^ key.low;
+    }
+};
+
+enum class CacheKind : uint64_t {
+    PDNF = 1,
+    TABLE = 2,
+};
+
+// canonicalKey hashes the arena of a parsed formula and its let bindings, so formulas
+// that only differ in whitespace get the same key. With alpha_rename the symbols are
+// hashed by their interned id, the order of their first occurrence, instead of by
+// name, so formulas that only differ in variable naming share the key as well.
+CacheKey canonicalKey(const Ast &ast, const SymbolTable &symbol_table, bool alpha_rename, CacheKind kind) {
+    CacheKey key;
+    key.Mix(uint64_t(kind));
+    key.Mix(alpha_rename);
+    key.Mix(ast.Size());
+    key.Mix(ast.Root());
+    for (uint32_t i = 0; i < ast.Size(); ++i) {
+        const auto &node = ast[i];
+        key.Mix(uint64_t(node.type));
+        key.Mix(node.left);
+        key.Mix(node.right);
+        if (node.type == TokenType::SYMBOL && !alpha_rename) {
+            key.Mix(fnv1a(ast.Symbol(node.symbol)));
+        } else {
+            key.Mix(node.symbol);
+        }
+    }
+    // the symbol table is hashed by token, position included, so its order changes with
+    // whitespace: the bindings are sorted by name, or by id, before they are mixed in
+    std::vector<std::pair<uint64_t, bool>> bindings;
+    std::vector<uint64_t> unused_bindings;
+    for (const auto &[token, constant]:symbol_table.getTokenToConstant()) {
+        if (!alpha_rename) {
+            bindings.emplace_back(fnv1a(token.value), constant.getValue());
+        } else if (auto id = ast.FindSymbol(token.value)) {
+            bindings.emplace_back(id.value(), constant.getValue());
+        } else {
+            // a binding of a symbol the formula does not use only adds a column
+            unused_bindings.push_back(constant.getValue());
+        }
+    }
+    std::ranges::sort(bindings);
+    std::ranges::sort(unused_bindings);
+    for (uint64_t i = 0; i < unused_bindings.size(); ++i) {
+        bindings.emplace_back(~i, unused_bindings[i]);
+    }
+    key.Mix(bindings.size());
+    for (auto[binding, value]:bindings) {
+        key.Mix(binding);
+        key.Mix(value);
+    }
+    return key;
+}
+
+// permuteRows reorders the variables of a truth table: bit j of an output row index is
+// bit source_bit[j] of the input row index.
+BitVector permuteRows(const BitVector &table, const std::vector<uint32_t> &source_bit) {
+    bool identity = true;
+    for (uint32_t j = 0; j < source_bit.size(); ++j) {
+        identity = identity && source_bit[j] == j;
+    }
+    if (identity) {
+        return table;
+    }
+    std::vector<uint64_t> words(table.Words().size());
+    for (size_t row = 0; row < table.Size(); ++row) {
+        size_t source = 0;
+        for (uint32_t j = 0; j < source_bit.size(); ++j) {
+            source |= ((row >> j) & 1) << source_bit[j];
+        }
+        words[row / ROWS_PER_WORD] |= uint64_t(table[source]) << (row % ROWS_PER_WORD);
+    }
+    return {std::move(words), table.Size()};
+}
+
+// LruCache keeps the capacity most recently used values. It is safe to share between
+// threads.
+template<typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity(capacity) {}
+
+    std::optional<Value> Find(const CacheKey &key) {
+        std::lock_guard lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return {};
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void Insert(const CacheKey &key, Value value) {
+        if (capacity == 0) {
+            return;
+        }
+        std::lock_guard lock(mutex);
+        if (auto it = index.find(key); it != index.end()) {
+            it->second->second = std::move(value);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(key, std::move(value));
+        index[key] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+private:
+    size_t capacity;
+    std::mutex mutex;
+    std::list<std::pair<CacheKey, Value>> entries;
+    std::unordered_map<CacheKey, typename std::list<std::pair<CacheKey, Value>>::iterator, CacheKeyHash> index;
+};
+
+struct CacheOptions {
+    // capacity is the number of verdicts and of truth tables kept in memory.
+    size_t capacity = 4096;
+    // directory, if set, also stores every entry on disk, so it survives the process.
+    std::optional<std::filesystem::path> directory;
+    // alpha_rename lets formulas that only differ in variable naming share entries.
+    bool alpha_rename = false;
+};
+
+// CompileCache sits in front of SemanticAnalyzer::FindPdnfError and CalculateFormula. Entries
+// are addressed by canonicalKey. Truth tables are stored with the free variables in
+// order of first occurrence and reordered to the table columns of the formula at hand,
+// which is what makes them shareable under alpha renaming. On disk a verdict is a
+// <key>.pdnf file, '1', or '0' followed by the error code, '@' and the occurrence, and
+// the message separated by spaces, and a table is a <key>.table truth table file.
+class CompileCache {
+public:
+    explicit CompileCache(CacheOptions options)
+            : options(std::move(options)), verdicts(this->options.capacity), tables(this->options.capacity) {
+        if (this->options.directory) {
+            std::filesystem::create_directories(this->options.directory.value());
+        }
+    }
+
+    std::optional<SemanticAnalyzer::PdnfError>
+    FindPdnfError(const Ast &ast, const SymbolTable &symbol_table, SemanticAnalyzer &analyzer) {
+        auto key = canonicalKey(ast, symbol_table, options.alpha_rename, CacheKind::PDNF);
+        // an occurrence out of the formula can only come from a damaged entry on disk
+        if (auto verdict = findVerdict(key);
+                verdict && (!verdict.value() || verdict.value()->occurrence < ast.Occurrences())) {
+            ++hits;
+            return verdict.value();
+        }
+        ++misses;
+        auto verdict = analyzer.FindPdnfError();
+        // the repeated symbols are named in the error, it is only valid for these names
+        if (!(options.alpha_rename && verdict && verdict->code == ErrorCode::REPEATED_VARIABLE)) {
+            storeVerdict(key, verdict);
+        }
+        return verdict;
+    }
+
+    SemanticAnalyzer::FormulaResult CalculateFormula(const Ast &ast, const SymbolTable &symbol_table,
+                                                     const SemanticAnalyzer &analyzer,
+                                                     const CalculateOptions &calculate_options) {
+        auto key = canonicalKey(ast, symbol_table, options.alpha_rename, CacheKind::TABLE);
+        auto free_symbols = analyzer.FreeSymbols();
+        // canonical column c is the free symbol with the c-th smallest id
+        std::vector<uint32_t> by_id(free_symbols.size());
+        for (uint32_t column = 0; column < by_id.size(); ++column) {
+            by_id[column] = column;
+        }
+        std::ranges::sort(by_id, [&](uint32_t lhs, uint32_t rhs) {
+            return free_symbols[lhs] < free_symbols[rhs];
+        });
+        if (auto table = findTable(key, free_symbols.size())) {
+            ++hits;
+            std::vector<uint32_t> canonical_of_column(by_id.size());
+            for (uint32_t c = 0; c < by_id.size(); ++c) {
+                canonical_of_column[by_id[c]] = c;
+            }
+            auto result = analyzer.ResultColumns();
+            result.results = permuteRows(table.value(), canonical_of_column);
+            return result;
+        }
+        ++misses;
+        auto result = analyzer.CalculateFormula(calculate_options);
+        storeTable(key, permuteRows(result.results, by_id));
+        return result;
+    }
+
+    size_t Hits() const {
+        return hits;
+    }
+
+    size_t Misses() const {
+        return misses;
+    }
+
+private:
+    using Verdict = std::optional<SemanticAnalyzer::PdnfError>;
+
+    std::optional<Verdict> findVerdict(const CacheKey &key) {
+        if (auto verdict = verdicts.Find(key)) {
+            return verdict;
+        }
+        if (!options.directory) {
+            return {};
+        }
+        std::ifstream file(entryPath(key, ".pdnf"), std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (content.empty() || (content[0] != '0' && content[0] != '1')) {
+            return {};
+        }
+        Verdict verdict;
+        if (content[0] == '0') {
+            std::istringstream is(content.substr(1));
+            int code = 0;
+            uint32_t occurrence = 0;
+            // entries of older versions hold the message alone, or a node instead of an
+            // '@' and the occurrence, and are not read
+            if (!(is >> code) || is.get() != ' ' || is.get() != '@' || !(is >> occurrence) || is.get() != ' ') {
+                return {};
+            }
+            verdict = SemanticAnalyzer::PdnfError{ErrorCode(code), occurrence,
+                                                  std::string(std::istreambuf_iterator<char>(is), {})};
+        }
+        verdicts.Insert(key, verdict);
+        return verdict;
+    }
+
+    void storeVerdict(const CacheKey &key, const Verdict &verdict) {
+        verdicts.Insert(key, verdict);
+        if (options.directory) {
+            writeEntry(entryPath(key, ".pdnf"), [&](std::ostream &os) {
+                if (verdict) {
+                    os << '0' << int(verdict->code) << " @" << verdict->occurrence << ' ' << verdict->message;
+                } else {
+                    os << '1';
+                }
+            });
+        }
+    }
+
+    std::optional<BitVector> findTable(const CacheKey &key, size_t variables) {
+        if (auto table = tables.Find(key)) {
+            return table;
+        }
+        if (!options.directory) {
+            return {};
+        }
+        auto path = entryPath(key, ".table");
+        if (!std::filesystem::exists(path)) {
+            return {};
+        }
+        try {
+            MappedTruthTable file(path.string());
+            if (file.Symbols().size() != variables || file.Rows() != (uint64_t(1) << variables)) {
+                return {};
+            }
+            BitVector table(std::vector<uint64_t>(file.Words(), file.Words() + wordsForRows(file.Rows())),
+                            file.Rows());
+            tables.Insert(key, table);
+            return table;
+        } catch (const std::exception &) {
+            return {};
+        }
+    }
+
+    void storeTable(const CacheKey &key, const BitVector &table) {
+        tables.Insert(key, table);
+        if (options.directory) {
+            SemanticAnalyzer::FormulaResult result;
+            for (size_t rows = 1; rows < table.Size(); rows *= 2) {
+                result.symbols.push_back("x" + std::to_string(result.symbols.size()));
+            }
+            result.results = table;
+            writeEntry(entryPath(key, ".table"), [&](std::ostream &os) {
+                writeTruthTable(os, result);
+            });
+        }
+    }
+
+    std::filesystem::path entryPath(const CacheKey &key, const std::string &extension) const {
+        return options.directory.value() / (key.Hex() + extension);
+    }
+
+    // writeEntry writes a temporary file and renames it over path, so concurrent readers
+    // and writers never see a partial entry. A failed write only loses the entry.
+    static void writeEntry(const std::filesystem::path &path, const std::function<void(std::ostream &)> &write) {
+        auto tmp = path;
+        tmp += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        try {
+            {
+                std::ofstream file(tmp, std::ios::binary);
+                write(file);
+                if (!file) {
+                    throw std::runtime_error("can't write cache entry");
+                }
+            }
+            std::filesystem::rename(tmp, path);
+        } catch (const std::exception &) {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+        }
+    }
+
+    CacheOptions options;
+    LruCache<Verdict> verdicts;
+    LruCache<BitVector> tables;
+    std::atomic<size_t> hits = 0;
+    std::atomic<size_t> misses = 0;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_COMPILE_CACHE_H
@@ -8,49 +8,396 @@
 #include "lexer.h"
 #include "parser.h"
 #include "semantic_analyzer.h"
+#include "compile_cache.h"
+#include "normal_form.h"
+#include "incremental.h"
+#include "stats.h"
 #include <exception>
 #include <optional>
 #include <utility>
 #include <any>
 #include <variant>
+#include <string_view>
 
 
+// CompiledFormula is a formula lexed and parsed once that can be calculated again and
+// again with new values for its let bindings. The truth table columns of the nodes are
+// cached, see IncrementalEvaluator, so a new binding only recomputes the nodes that
+// depend on it. The bound symbols are fixed by the formula, the table columns are the
+// ones CalculateFormula produces.
+class CompiledFormula {
+public:
+    CompiledFormula(const Ast &ast, const std::shared_ptr<SymbolTable> &symbol_table,
+                    const CalculateOptions &options = {}) : evaluator(makeEvaluator(ast, symbol_table, options)) {}
+
+    // Bindings returns the names of the symbols bound by let, in table column order.
+    std::vector<std::string> Bindings() const {
+        return {columns.symbols.begin(), columns.symbols.begin() + columns.bound_values.size()};
+    }
+
+    // Bind sets the value of a let binding for the next Calculate. A symbol bound more
+    // than once takes the value of its last column, as in CalculateFormula, so that is
+    // the one Bind sets.
+    void Bind(const std::string &symbol, bool value) {
+        auto column = bindingColumn(symbol);
+        if (!column) {
+            throw std::invalid_argument("symbol isn't bound by let: " + symbol);
+        }
+        columns.bound_values[column.value()] = value;
+    }
+
+    SemanticAnalyzer::FormulaResult Calculate() {
+        std::vector<bool> values(columns.bound_values.begin(), columns.bound_values.end());
+        const auto &words = evaluator.Evaluate(values);
+        auto result = columns;
+        size_t variables = columns.symbols.size() - columns.bound_values.size();
+        result.results = BitVector(words, size_t(1) << variables);
+        return result;
+    }
+
+    // Recomputed is the number of nodes the last Calculate computed.
+    size_t Recomputed() const {
+        return evaluator.Recomputed();
+    }
+
+private:
+    // bindingColumn returns the last column binding symbol, the one evaluated.
+    std::optional<uint32_t> bindingColumn(const std::string &symbol) const {
+        std::optional<uint32_t> column;
+        for (uint32_t b = 0; b < columns.bound_values.size(); ++b) {
+            if (columns.symbols[b] == symbol) {
+                column = b;
+            }
+        }
+        return column;
+    }
+
+    IncrementalEvaluator makeEvaluator(const Ast &ast, const std::shared_ptr<SymbolTable> &symbol_table,
+                                       const CalculateOptions &options) {
+        SemanticAnalyzer analyzer(ast, symbol_table);
+        columns = analyzer.ResultColumns();
+        std::vector<SymbolInput> inputs(ast.Symbols().size());
+        for (uint32_t b = 0; b < columns.bound_values.size(); ++b) {
+            if (auto id = ast.FindSymbol(columns.symbols[b])) {
+                inputs[id.value()] = {true, bindingColumn(columns.symbols[b]).value()};
+            }
+        }
+        auto free_symbols = analyzer.FreeSymbols();
+        for (uint32_t column = 0; column < free_symbols.size(); ++column) {
+            inputs[free_symbols[column]] = {false, column};
+        }
+        return {ast, inputs, uint32_t(free_symbols.size()), uint32_t(columns.bound_values.size()),
+                selectKernels(options.kernel)};
+    }
+
+    SemanticAnalyzer::FormulaResult columns;
+    IncrementalEvaluator evaluator;
+};
+
+// checkPDNF runs the PDNF check of a parsed formula, through cache if there is one.
+std::optional<Diagnostic> checkPDNF(const Ast &ast, const SymbolTable &symbol_table, SemanticAnalyzer &analyzer,
+                                    CompileCache *cache) {
+    auto pdnf_error = cache ? cache->FindPdnfError(ast, symbol_table, analyzer) : analyzer.FindPdnfError();
+    if (pdnf_error) {
+        return pdnf_error->At(ast);
+    }
+    return {};
+}
+
+// evaluate calculates the truth table of a parsed formula, through cache if there is one.
+// Any formula that parses can be evaluated, so what is caught here is an engine that runs
+// out of memory or beyond its limits, not a rejected input.
+Expected<SemanticAnalyzer::FormulaResult>
+evaluate(const Ast &ast, const SymbolTable &symbol_table, const SemanticAnalyzer &analyzer,
+         const CalculateOptions &options, CompileCache *cache) {
+    try {
+        if (cache) {
+            return cache->CalculateFormula(ast, symbol_table, analyzer, options);
+        }
+        return analyzer.CalculateFormula(options);
+    } catch (const std::exception &ex) {
+        return Diagnostic{ErrorCode::EVALUATION_FAILED, ast.Span(ast.RootOccurrence()), ex.what()};
+    }
+}
+
+// messageOf turns a diagnostic into the error string of the string based interface.
+std::optional<std::string> messageOf(std::optional<Diagnostic> &&diagnostic) {
+    if (diagnostic) {
+        return std::move(diagnostic->message);
+    }
+    return {};
+}
+
+template<typename T>
+std::variant<T, std::string> messageOf(Expected<T> &&expected) {
+    if (expected) {
+        return std::move(expected.value());
+    }
+    return expected.error().message;
+}
+
 class Compiler {
 public:
     explicit Compiler(std::string str) : source(std::move(str)) {}
 
     explicit Compiler(std::unique_ptr<std::istream> &&stream) : istream(std::move(stream)) {}
 
+    // The formula is lexed in place from the mapped file, without copying it.
+    explicit Compiler(std::shared_ptr<const MappedFile> file) : file(std::move(file)) {}
+
+    // SetCache answers IsPDNF and CalculateFormula from cache when it has seen the formula.
+    void SetCache(std::shared_ptr<CompileCache> compile_cache) {
+        cache = std::move(compile_cache);
+    }
+
+    // SetStats times the phases of the following calls and counts what they process into
+    // compile_stats, see CompileStats.
+    void SetStats(std::shared_ptr<CompileStats> compile_stats) {
+        stats = std::move(compile_stats);
+    }
+
+    // CheckPDNF tells why the formula does not parse or is not in PDNF, or nothing when it
+    // is in PDNF. A rejected formula is returned like an accepted one, without throwing.
+    std::optional<Diagnostic> CheckPDNF() {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        auto parser = parse(symbol_table);
+        if (!parser) {
+            return parser.error();
+        }
+        SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+        CompileStats::Timer timer(stats.get(), "check pdnf");
+        return checkPDNF(parser->GetAst(), *symbol_table, analyzer, cache.get());
+    }
 
     std::optional<std::string> IsPDNF() {
+        return messageOf(CheckPDNF());
+    }
+
+    // Calculate returns the truth table of the formula or why it does not parse, see
+    // CheckPDNF.
+    Expected<SemanticAnalyzer::FormulaResult> Calculate(const CalculateOptions &options = {}) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        auto parser = parse(symbol_table);
+        if (!parser) {
+            return parser.error();
+        }
+        simplify(parser.value());
+        SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+        countVariables(analyzer, *symbol_table, true);
+        CompileStats::Timer timer(stats.get(), "evaluate");
+        return evaluate(parser->GetAst(), *symbol_table, analyzer, options, cache.get());
+    }
+
+    std::variant<SemanticAnalyzer::FormulaResult, std::string>
+    CalculateFormula(const CalculateOptions &options = {}) {
+        return messageOf(Calculate(options));
+    }
+
+    // StreamFormula emits the truth table through the callbacks as it is computed, see
+    // SemanticAnalyzer::StreamFormula. It returns the error, if any.
+    std::optional<std::string> StreamFormula(const SemanticAnalyzer::SymbolsCallback &on_symbols,
+                                             const SemanticAnalyzer::RowCallback &on_row,
+                                             const CalculateOptions &options = {}) {
+        try {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            countVariables(analyzer, *symbol_table, true);
+            CompileStats::Timer timer(stats.get(), "evaluate");
+            analyzer.StreamFormula(on_symbols, on_row, options);
+            return {};
+        } catch (const std::exception &ex) {
+            return {ex.what()};
+        }
+    }
+
+    // Compile parses the formula once into a handle that recalculates it for new values
+    // of its let bindings.
+    std::variant<CompiledFormula, std::string> Compile(const CalculateOptions &options = {}) {
         try {
             auto symbol_table = std::make_shared<SymbolTable>();
-            auto lexer = getLexer(symbol_table);
-            auto parser = Parser(std::move(lexer), symbol_table);
-            parser.build();
-            SemanticAnalyzer analyzer(parser.GetRoot(), symbol_table);
-            return analyzer.IsPDNF();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value(), false);
+            CompileStats::Timer timer(stats.get(), "compile");
+            return CompiledFormula(parser->GetAst(), symbol_table, options);
         } catch (const std::exception &ex) {
             return {ex.what()};
         }
     }
 
-    std::variant<SemanticAnalyzer::FormulaResult, std::string> CalculateFormula() {
+    // StreamNormalForm writes the perfect normal form of the formula to os term by term,
+    // see NormalFormWriter. It returns the error, if any.
+    std::optional<std::string> StreamNormalForm(std::ostream &os, NormalForm form,
+                                                const CalculateOptions &options = {}) {
         try {
             auto symbol_table = std::make_shared<SymbolTable>();
-            auto lexer = getLexer(symbol_table);
-            auto parser = Parser(std::move(lexer), symbol_table);
-            parser.build();
-            SemanticAnalyzer analyzer(parser.GetRoot(), symbol_table);
-            return analyzer.CalculateFormula();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            countVariables(analyzer, *symbol_table, true);
+            NormalFormWriter writer(os, analyzer.FreeSymbolNames(), form);
+            CompileStats::Timer timer(stats.get(), "evaluate");
+            CompileStats::SampledTimer term_timer(stats.get(), "render");
+            analyzer.StreamRows(form == NormalForm::PDNF, [&](size_t row) {
+                term_timer.Time([&] { writer.WriteTerm(row); });
+            }, options);
+            CompileStats::Timer render_timer(stats.get(), "render");
+            writer.Finish();
+            return {};
+        } catch (const std::exception &ex) {
+            return {ex.what()};
+        }
+    }
+
+    std::variant<SemanticAnalyzer::BddSummary, std::string> AnalyzeBdd() {
+        try {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            countVariables(analyzer, *symbol_table);
+            CompileStats::Timer timer(stats.get(), "bdd");
+            return analyzer.AnalyzeBdd();
+        } catch (const std::exception &ex) {
+            return {ex.what()};
+        }
+    }
+
+    // FindRow returns a row where the formula takes value, see SemanticAnalyzer::FindRow.
+    std::variant<SemanticAnalyzer::SatResult, std::string> FindRow(bool value) {
+        try {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            countVariables(analyzer, *symbol_table);
+            CompileStats::Timer timer(stats.get(), "sat");
+            return analyzer.FindRow(value);
+        } catch (const std::exception &ex) {
+            return {ex.what()};
+        }
+    }
+
+    std::variant<Cover, std::string> Minimize() {
+        try {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            countVariables(analyzer, *symbol_table);
+            CompileStats::Timer timer(stats.get(), "minimize");
+            return analyzer.Minimize();
+        } catch (const std::exception &ex) {
+            return {ex.what()};
+        }
+    }
+
+    // IsEquivalent tells whether the formula and other agree on every assignment of the
+    // free symbols of both. Both are built in one BDD manager over the union of their
+    // free symbols, where equal functions are the same node.
+    std::variant<bool, std::string> IsEquivalent(const std::string &other) {
+        try {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            auto parser = parse(symbol_table);
+            if (!parser) {
+                return parser.error().message;
+            }
+            simplify(parser.value());
+            auto other_symbol_table = std::make_shared<SymbolTable>();
+            auto other_parser = Parser(std::make_unique<Lexer>(Lexer(other, other_symbol_table)),
+                                       other_symbol_table);
+            other_parser.SetStats(stats.get());
+            {
+                CompileStats::Timer timer(stats.get(), "parse");
+                if (auto diagnostic = other_parser.Parse()) {
+                    return diagnostic->message;
+                }
+            }
+            {
+                CompileStats::Timer timer(stats.get(), "simplify");
+                other_parser.Simplify();
+            }
+            SemanticAnalyzer analyzer(parser->GetAst(), symbol_table);
+            SemanticAnalyzer other_analyzer(other_parser.GetAst(), other_symbol_table);
+            CompileStats::Timer timer(stats.get(), "bdd");
+
+            auto variables = analyzer.FreeSymbolNames();
+            auto other_variables = other_analyzer.FreeSymbolNames();
+            variables.insert(variables.end(), other_variables.begin(), other_variables.end());
+            std::ranges::sort(variables);
+            variables.erase(std::unique(variables.begin(), variables.end()), variables.end());
+            BddManager manager(variables.size());
+            return analyzer.BuildBdd(manager, variables) == other_analyzer.BuildBdd(manager, variables);
         } catch (const std::exception &ex) {
             return {ex.what()};
         }
     }
 
 private:
+    // parse builds the formula. The parser times lexing itself, see Parser::SetStats, so
+    // the parse phase is the time of the parser alone.
+    Expected<Parser> parse(const std::shared_ptr<SymbolTable> &symbol_table) {
+        auto parser = Parser(getLexer(symbol_table), symbol_table);
+        parser.SetStats(stats.get());
+        std::optional<Diagnostic> diagnostic;
+        {
+            CompileStats::Timer timer(stats.get(), "parse");
+            diagnostic = parser.Parse();
+        }
+        if (stats) {
+            stats->tokens = parser.Tokens();
+        }
+        if (diagnostic) {
+            return std::move(diagnostic.value());
+        }
+        if (stats) {
+            stats->CountNodes(parser.GetAst(), parser.GetAst().Root());
+        }
+        return parser;
+    }
+
+    // simplify resolves the let bindings and simplifies the formula, see Parser::Simplify.
+    void simplify(Parser &parser, bool fold_bindings = true) {
+        CompileStats::Timer timer(stats.get(), "simplify");
+        parser.Simplify(fold_bindings);
+        if (stats) {
+            stats->CountSimplifiedNodes(parser.GetAst(), parser.GetAst().EvaluationRoot());
+        }
+    }
+
+    // countVariables records the variables of the formula, and with rows the truth table
+    // rows that are about to be evaluated.
+    void countVariables(const SemanticAnalyzer &analyzer, const SymbolTable &symbol_table, bool rows = false) {
+        if (stats) {
+            stats->variables = analyzer.FreeSymbols().size();
+            stats->bound_variables = symbol_table.getTokenToConstant().size();
+            stats->rows = rows ? uint64_t(1) << stats->variables : 0;
+        }
+    }
 
     std::unique_ptr<Lexer> getLexer(const std::shared_ptr<SymbolTable> &symbolTable) {
+        if (file) {
+            return std::make_unique<Lexer>(Lexer(file, symbolTable));
+        }
         if (istream) {
             return std::make_unique<Lexer>(Lexer(std::move(istream), symbolTable));
         }
@@ -59,6 +406,61 @@ private:
 
     std::string source;
     std::unique_ptr<std::istream> istream;
+    std::shared_ptr<const MappedFile> file;
+    std::shared_ptr<CompileCache> cache;
+    std::shared_ptr<CompileStats> stats;
+};
+
+// BatchCompiler compiles many formulas one after another. The symbol table, the lexer
+// and the parser arena are kept between formulas, so a formula only allocates what the
+// previous ones did not already. The formula views must stay valid during a call.
+class BatchCompiler {
+public:
+    BatchCompiler() : symbol_table(std::make_shared<SymbolTable>()),
+                      parser(std::make_unique<Lexer>(std::string_view(), symbol_table), symbol_table) {}
+
+    void SetCache(std::shared_ptr<CompileCache> compile_cache) {
+        cache = std::move(compile_cache);
+    }
+
+    // CheckPDNF and Calculate report errors like their Compiler namesakes, without
+    // throwing, so a batch of mostly invalid formulas runs as fast as a valid one.
+    std::optional<Diagnostic> CheckPDNF(std::string_view formula) {
+        if (auto diagnostic = parse(formula)) {
+            return diagnostic;
+        }
+        SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+        return checkPDNF(parser.GetAst(), *symbol_table, analyzer, cache.get());
+    }
+
+    std::optional<std::string> IsPDNF(std::string_view formula) {
+        return messageOf(CheckPDNF(formula));
+    }
+
+    Expected<SemanticAnalyzer::FormulaResult> Calculate(std::string_view formula, const CalculateOptions &options = {}) {
+        if (auto diagnostic = parse(formula)) {
+            return std::move(diagnostic.value());
+        }
+        parser.Simplify();
+        SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+        return evaluate(parser.GetAst(), *symbol_table, analyzer, options, cache.get());
+    }
+
+    std::variant<SemanticAnalyzer::FormulaResult, std::string>
+    CalculateFormula(std::string_view formula, const CalculateOptions &options = {}) {
+        return messageOf(Calculate(formula, options));
+    }
+
+private:
+    std::optional<Diagnostic> parse(std::string_view formula) {
+        symbol_table->Clear();
+        parser.Reset(formula);
+        return parser.Parse();
+    }
+
+    std::shared_ptr<SymbolTable> symbol_table;
+    Parser parser;
+    std::shared_ptr<CompileCache> cache;
 };
 
 #endif //INC_1LAB_COMPILER_H
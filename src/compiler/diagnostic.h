@@ -0,0 +1,113 @@
+//
+// Created by illfate on 5/15/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_DIAGNOSTIC_H
+#define BOOLEAN_EXPRESSION_COMPILER_DIAGNOSTIC_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+
+enum class ErrorCode {
+    // UNEXPECTED_EOF is input that ends in the middle of a formula.
+    UNEXPECTED_EOF,
+    // UNSUPPORTED_CHARACTER is a character no token starts with.
+    UNSUPPORTED_CHARACTER,
+    // INCOMPLETE_OPERATOR is the start of ->, /\, \/ or let without the rest.
+    INCOMPLETE_OPERATOR,
+    // UNEXPECTED_TOKEN is a token the grammar does not allow where it stands.
+    UNEXPECTED_TOKEN,
+    // TRAILING_INPUT is a token after a complete formula.
+    TRAILING_INPUT,
+
+    // The codes below reject a well-formed formula that is not in PDNF.
+
+    // NOT_A_DISJUNCTION is a formula that is neither a disjunction nor a conjunction.
+    NOT_A_DISJUNCTION,
+    // UNEXPECTED_OPERATOR is an operand of the disjunction that is not a conjunction.
+    UNEXPECTED_OPERATOR,
+    // NOT_A_LITERAL is an operand of a conjunction that is not a symbol or its negation.
+    NOT_A_LITERAL,
+    // REPEATED_VARIABLE is a symbol that occurs twice in one conjunction.
+    REPEATED_VARIABLE,
+    // REPEATED_CONJUNCTION is a conjunction that occurs twice.
+    REPEATED_CONJUNCTION,
+    // TOO_MANY_CONJUNCTIONS is more conjunctions than there are rows of the truth table.
+    TOO_MANY_CONJUNCTIONS,
+    // DIFFERENT_VARIABLES is a conjunction over other symbols than the first one.
+    DIFFERENT_VARIABLES,
+
+    // EVALUATION_FAILED is a formula the engine could not evaluate, e.g. one with more
+    // variables than its truth table can have rows.
+    EVALUATION_FAILED,
+};
+
+// SourceSpan is a range of the input. position is the position of its first character
+// as in Token, or -1 at the end of the input; length is the number of characters.
+struct SourceSpan {
+    int64_t position = -1;
+    int64_t length = 0;
+
+    bool operator==(const SourceSpan &other) const = default;
+};
+
+// Diagnostic is an error in a formula: what is wrong, where, and the text the CLI prints.
+struct Diagnostic {
+    ErrorCode code;
+    SourceSpan span;
+    std::string message;
+};
+
+// Expected holds either a value or the Diagnostic why there is none, with the interface
+// of std::expected<T, Diagnostic>, which is C++23. Errors are returned through it rather
+// than thrown, so rejecting a formula costs no more than accepting it.
+template<typename T>
+class Expected {
+public:
+    Expected(T value) : result(std::in_place_index<0>, std::move(value)) {}
+
+    Expected(Diagnostic diagnostic) : result(std::in_place_index<1>, std::move(diagnostic)) {}
+
+    bool has_value() const {
+        return result.index() == 0;
+    }
+
+    explicit operator bool() const {
+        return has_value();
+    }
+
+    T &value() {
+        return std::get<0>(result);
+    }
+
+    const T &value() const {
+        return std::get<0>(result);
+    }
+
+    T &operator*() {
+        return value();
+    }
+
+    const T &operator*() const {
+        return value();
+    }
+
+    T *operator->() {
+        return &value();
+    }
+
+    const T *operator->() const {
+        return &value();
+    }
+
+    const Diagnostic &error() const {
+        return std::get<1>(result);
+    }
+
+private:
+    std::variant<T, Diagnostic> result;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_DIAGNOSTIC_H
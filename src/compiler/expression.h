@@ -11,6 +11,8 @@
 
 class BooleanExpression {
 public:
+    virtual ~BooleanExpression() = default;
+
     virtual bool interpret() const = 0;
 
     virtual std::string string() const = 0;
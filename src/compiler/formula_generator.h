@@ -0,0 +1,281 @@
+//
+// Created by illfate on 5/12/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_FORMULA_GENERATOR_H
+#define BOOLEAN_EXPRESSION_COMPILER_FORMULA_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t MAX_GENERATED_VARIABLES = 26;
+
+// FormulaGenerator writes formulas in the input syntax for benchmarks and tests. The
+// output only depends on the seed: std::mt19937_64 is specified bit for bit and the
+// draws are taken from it directly, not through the implementation-defined
+// distributions. All formulas are built bottom-up, so their depth is not limited by
+// the stack.
+class FormulaGenerator {
+public:
+    explicit FormulaGenerator(uint64_t seed) : engine(seed) {}
+
+    // Random returns a formula of operations binary operations over the first variables
+    // letters, each of which occurs. Operands are paired at random, so the shape ranges
+    // from balanced to chains, and a tenth of the operands are negated.
+    std::string Random(uint32_t variables, size_t operations) {
+        checkVariables(variables);
+        if (operations + 1 < variables) {
+            throw std::invalid_argument("too few operations to use every variable");
+        }
+        std::vector<std::string> operands;
+        for (size_t i = 0; i <= operations; ++i) {
+            operands.push_back(literal(i < variables ? i : draw(variables)));
+        }
+        while (operands.size() > 1) {
+            size_t i = draw(operands.size());
+            std::swap(operands[i], operands.back());
+            std::string right = std::move(operands.back());
+            operands.pop_back();
+            size_t j = draw(operands.size());
+            operands[j] = binary(operands[j], right);
+            if (draw(10) == 0) {
+                operands[j] = "(!" + operands[j] + ")";
+            }
+        }
+        return operands.front();
+    }
+
+    // Wide returns a balanced formula of 2^levels - 1 operations, depth levels.
+    std::string Wide(uint32_t variables, uint32_t levels) {
+        checkVariables(variables);
+        std::vector<std::string> operands;
+        for (size_t i = 0; i < (size_t(1) << levels); ++i) {
+            operands.push_back(literal(draw(variables)));
+        }
+        while (operands.size() > 1) {
+            std::vector<std::string> next;
+            for (size_t i = 0; i < operands.size(); i += 2) {
+                next.push_back(binary(operands[i], operands[i + 1]));
+            }
+            operands = std::move(next);
+        }
+        return operands.front();
+    }
+
+    // Deep returns a chain of depth operations nested to the left.
+    std::string Deep(uint32_t variables, size_t depth) {
+        checkVariables(variables);
+        std::string formula(depth, '(');
+        formula += literal(draw(variables));
+        for (size_t i = 0; i < depth; ++i) {
+            formula += OPERATORS[draw(std::size(OPERATORS))];
+            formula += literal(draw(variables));
+            formula += ')';
+        }
+        return formula;
+    }
+
+    // Mixed is Random with the inputs that stress the simplifier and the engines: a tenth of
+    // the operands are constants and a tenth of the operations reuse an operand on both
+    // sides, which the arena shares, so complements, idempotence and absorption show up.
+    std::string Mixed(uint32_t variables, size_t operations) {
+        checkVariables(variables);
+        std::vector<std::string> operands;
+        for (size_t i = 0; i <= operations; ++i) {
+            if (i >= variables && draw(10) == 0) {
+                operands.emplace_back(draw(2) ? "1" : "0");
+            } else {
+                operands.push_back(literal(i < variables ? i : draw(variables)));
+            }
+        }
+        while (operands.size() > 1) {
+            size_t i = draw(operands.size());
+            std::swap(operands[i], operands.back());
+            std::string right = std::move(operands.back());
+            operands.pop_back();
+            size_t j = draw(operands.size());
+            if (draw(10) == 0) {
+                // (X op (!X)) or (X op X) of the operand just taken
+                operands.push_back(binary(right, draw(2) ? right : "(!" + right + ")"));
+                continue;
+            }
+            operands[j] = binary(operands[j], right);
+            if (draw(10) == 0) {
+                operands[j] = "(!" + operands[j] + ")";
+            }
+        }
+        return operands.front();
+    }
+
+    // Bindings returns let bindings of count distinct letters among the first variables to
+    // random values, to be put in front of a formula.
+    std::string Bindings(uint32_t variables, uint32_t count) {
+        checkVariables(variables);
+        std::vector<uint32_t> letters(variables);
+        for (uint32_t j = 0; j < variables; ++j) {
+            letters[j] = j;
+        }
+        std::string bindings;
+        for (uint32_t i = 0; i < std::min(count, variables); ++i) {
+            std::swap(letters[i], letters[i + draw(variables - i)]);
+            bindings += "let " + variableName(letters[i]) + "=" + (draw(2) ? "1" : "0") + "; ";
+        }
+        return bindings;
+    }
+
+    // Spaced puts spaces and line breaks after opening and before closing brackets of
+    // formula, nothing is added after its end.
+    std::string Spaced(const std::string &formula) {
+        std::string spaced;
+        for (size_t i = 0; i < formula.size(); ++i) {
+            if (formula[i] == ')' && draw(4) == 0) {
+                spaced += draw(2) ? ' ' : '\n';
+            }
+            spaced += formula[i];
+            if (formula[i] == '(' && draw(4) == 0) {
+                spaced += draw(2) ? ' ' : '\n';
+            }
+        }
+        return spaced;
+    }
+
+    // Pdnf returns a perfect disjunctive normal form of minterms distinct minterms over
+    // the first variables letters.
+    std::string Pdnf(uint32_t variables, size_t minterms) {
+        auto terms = pickMinterms(variables, minterms);
+        return joinTerms(terms);
+    }
+
+    // PdnfCandidate returns a disjunction of minterms that is a perfect normal form about
+    // half of the time. Otherwise one term is broken: duplicated, missing or repeating a
+    // variable, with a random variable, a double negation or a disjunction inside.
+    std::string PdnfCandidate(uint32_t variables, size_t minterms) {
+        auto terms = pickMinterms(variables, minterms);
+        if (draw(2) == 0) {
+            return joinTerms(terms);
+        }
+        size_t k = draw(terms.size());
+        uint64_t row = rowOf(terms[k]);
+        std::vector<std::string> literals;
+        for (uint32_t j = 0; j < variables; ++j) {
+            literals.push_back((row >> j) & 1 ? variableName(j) : "(!" + variableName(j) + ")");
+        }
+        size_t j = draw(variables);
+        switch (draw(6)) {
+            case 0:
+                terms.push_back(terms[k]);
+                return joinTerms(terms);
+            case 1:
+                if (literals.size() > 1) {
+                    literals.erase(literals.begin() + j);
+                }
+                break;
+            case 2:
+                literals.push_back(literals[j]);
+                break;
+            case 3:
+                literals[j] = variableName(draw(MAX_GENERATED_VARIABLES));
+                break;
+            case 4:
+                literals[j] = "(!(!" + variableName(j) + "))";
+                break;
+            default:
+                if (literals.size() > 1) {
+                    literals[0] = "(" + literals[0] + "\\/" + literals[1] + ")";
+                    literals.erase(literals.begin() + 1);
+                }
+        }
+        terms[k] = joinLiterals(literals);
+        return joinTerms(terms);
+    }
+
+    static std::string variableName(uint32_t variable) {
+        return std::string(1, char('A' + variable));
+    }
+
+private:
+    static constexpr const char *OPERATORS[] = {"/\\", "\\/", "->", "~"};
+
+    static void checkVariables(uint32_t variables) {
+        if (variables == 0 || variables > MAX_GENERATED_VARIABLES) {
+            throw std::invalid_argument("formulas have between 1 and 26 variables");
+        }
+    }
+
+    // draw returns a number below bound, the modulo bias is negligible for our bounds.
+    uint64_t draw(uint64_t bound) {
+        return engine() % bound;
+    }
+
+    std::string literal(uint32_t variable) {
+        return draw(10) == 0 ? "(!" + variableName(variable) + ")" : variableName(variable);
+    }
+
+    std::string binary(const std::string &left, const std::string &right) {
+        return "(" + left + OPERATORS[draw(std::size(OPERATORS))] + right + ")";
+    }
+
+    // pickMinterms returns the minterms of minterms distinct random rows, a partial
+    // Fisher-Yates shuffle picks the rows.
+    std::vector<std::string> pickMinterms(uint32_t variables, size_t minterms) {
+        checkVariables(variables);
+        size_t rows = size_t(1) << variables;
+        if (minterms == 0 || minterms > rows) {
+            throw std::invalid_argument("a pdnf needs between 1 and 2^variables minterms");
+        }
+        std::vector<uint32_t> picked(rows);
+        for (size_t row = 0; row < rows; ++row) {
+            picked[row] = row;
+        }
+        std::vector<std::string> terms;
+        for (size_t i = 0; i < minterms; ++i) {
+            std::swap(picked[i], picked[i + draw(rows - i)]);
+            std::vector<std::string> literals;
+            for (uint32_t j = 0; j < variables; ++j) {
+                literals.push_back((picked[i] >> j) & 1 ? variableName(j) : "(!" + variableName(j) + ")");
+            }
+            terms.push_back(joinLiterals(literals));
+        }
+        return terms;
+    }
+
+    // rowOf reads the row back from a minterm of pickMinterms.
+    static uint64_t rowOf(const std::string &minterm) {
+        uint64_t row = 0;
+        for (size_t i = 0; i < minterm.size(); ++i) {
+            if (minterm[i] >= 'A' && minterm[i] <= 'Z' && (i == 0 || minterm[i - 1] != '!')) {
+                row |= uint64_t(1) << (minterm[i] - 'A');
+            }
+        }
+        return row;
+    }
+
+    // joinLiterals and joinTerms group a conjunction and a disjunction from the left.
+    static std::string joinLiterals(const std::vector<std::string> &literals) {
+        return join(literals, "/\\");
+    }
+
+    static std::string joinTerms(const std::vector<std::string> &terms) {
+        return join(terms, "\\/");
+    }
+
+    static std::string join(const std::vector<std::string> &operands, const char *op) {
+        std::string joined(operands.size() - 1, '(');
+        for (size_t i = 0; i < operands.size(); ++i) {
+            if (i > 0) {
+                joined.append(op).append(operands[i]).append(")");
+            } else {
+                joined += operands[i];
+            }
+        }
+        return joined;
+    }
+
+    std::mt19937_64 engine;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_FORMULA_GENERATOR_H
@@ -0,0 +1,172 @@
+//
+// Created by illfate on 5/10/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_INCREMENTAL_H
+#define BOOLEAN_EXPRESSION_COMPILER_INCREMENTAL_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "kernels.h"
+#include "row_patterns.h"
+
+// SymbolInput tells where the value of a symbol comes from: the free variable of table
+// column index, or the let binding with ordinal index.
+struct SymbolInput {
+    bool bound;
+    uint32_t index;
+};
+
+// IncrementalEvaluator keeps the packed truth table column of every node of a formula,
+// together with a mask of the let bindings the node depends on. Evaluate only
+// recomputes the nodes that depend on a binding whose value changed since the last
+// call, everything else is served from the cached columns. The cache holds one column
+// of 2^variables bits per node. The arena is copied into the evaluator, so it does not
+// need the Ast afterwards.
+class IncrementalEvaluator {
+public:
+    static constexpr uint32_t MAX_BINDINGS = 64;
+
+    IncrementalEvaluator(const Ast &ast, const std::vector<SymbolInput> &inputs, uint32_t variables,
+                         uint32_t bindings, const WordKernels &kernels)
+            : bindings(bindings), kernels(&kernels),
+              words(wordsForRows(size_t(1) << variables)) {
+        if (bindings > MAX_BINDINGS) {
+            throw std::invalid_argument("too many let bindings: " + std::to_string(bindings));
+        }
+        uint32_t root = ast.EvaluationRoot();
+        std::vector<bool> reachable(root + 1);
+        std::vector<uint32_t> stack{root};
+        reachable[root] = true;
+        while (!stack.empty()) {
+            const auto &node = ast[stack.back()];
+            stack.pop_back();
+            if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+                continue;
+            }
+            for (uint32_t child:{node.left, node.right}) {
+                if (child != NO_NODE && !reachable[child]) {
+                    reachable[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+        // children have smaller indices than their parents, so slots follow the same order
+        std::vector<uint32_t> slot_of(root + 1);
+        for (uint32_t index = 0; index <= root; ++index) {
+            if (!reachable[index]) {
+                continue;
+            }
+            auto node = ast[index];
+            uint64_t dependencies = 0;
+            if (node.type == TokenType::SYMBOL) {
+                SymbolInput input = inputs[node.symbol];
+                node.type = input.bound ? TokenType::CONSTANT : TokenType::SYMBOL;
+                node.symbol = input.index;
+                dependencies = input.bound ? uint64_t(1) << input.index : 0;
+                bound_symbols.push_back(input.bound);
+            } else {
+                bound_symbols.push_back(false);
+                if (node.left != NO_NODE) {
+                    node.left = slot_of[node.left];
+                    dependencies |= masks[node.left];
+                }
+                if (node.right != NO_NODE) {
+                    node.right = slot_of[node.right];
+                    dependencies |= masks[node.right];
+                }
+            }
+            slot_of[index] = nodes.size();
+            nodes.push_back(node);
+            masks.push_back(dependencies);
+        }
+        columns.assign(nodes.size(), std::vector<uint64_t>(words));
+    }
+
+    // Evaluate returns the result column for the given values of the let bindings, bit i
+    // of the column is row i.
+    const std::vector<uint64_t> &Evaluate(const std::vector<bool> &binding_values) {
+        if (binding_values.size() != bindings) {
+            throw std::invalid_argument("expected " + std::to_string(bindings) + " binding values");
+        }
+        uint64_t changed = 0;
+        for (uint32_t b = 0; b < bindings; ++b) {
+            if (!evaluated || binding_values[b] != values[b]) {
+                changed |= uint64_t(1) << b;
+            }
+        }
+        values = binding_values;
+        recomputed = 0;
+        for (uint32_t slot = 0; slot < nodes.size(); ++slot) {
+            if (evaluated && (masks[slot] & changed) == 0) {
+                continue;
+            }
+            compute(slot);
+            ++recomputed;
+        }
+        evaluated = true;
+        return columns.back();
+    }
+
+    // Recomputed is the number of nodes the last Evaluate computed.
+    size_t Recomputed() const {
+        return recomputed;
+    }
+
+    size_t Nodes() const {
+        return nodes.size();
+    }
+
+private:
+    void compute(uint32_t slot) {
+        const auto &node = nodes[slot];
+        auto &column = columns[slot];
+        switch (node.type) {
+            case TokenType::SYMBOL:
+                for (size_t w = 0; w < words; ++w) {
+                    column[w] = rowPattern(node.symbol, w);
+                }
+                break;
+            case TokenType::CONSTANT:
+                kernels->fill(column.data(),
+                              (bound_symbols[slot] ? values[node.symbol] : node.symbol) ? ~uint64_t(0) : 0, words);
+                break;
+            case TokenType::NOT_OPERATOR:
+                kernels->not_op(column.data(), columns[node.left].data(), words);
+                break;
+            case TokenType::AND_OPERATOR:
+                kernels->and_op(column.data(), columns[node.left].data(), columns[node.right].data(), words);
+                break;
+            case TokenType::OR_OPERATOR:
+                kernels->or_op(column.data(), columns[node.left].data(), columns[node.right].data(), words);
+                break;
+            case TokenType::IMPLICATION:
+                kernels->implication_op(column.data(), columns[node.left].data(), columns[node.right].data(),
+                                        words);
+                break;
+            case TokenType::EQUALITY:
+                kernels->equality_op(column.data(), columns[node.left].data(), columns[node.right].data(), words);
+                break;
+            default:
+                throw std::invalid_argument("unexpected node in formula");
+        }
+    }
+
+    uint32_t bindings;
+    const WordKernels *kernels;
+    size_t words;
+    // nodes are the reachable arena nodes with children renumbered to slots; a symbol
+    // becomes a SYMBOL of its column or a CONSTANT of its binding ordinal
+    std::vector<AstNode> nodes;
+    std::vector<bool> bound_symbols;
+    std::vector<uint64_t> masks;
+    std::vector<std::vector<uint64_t>> columns;
+    std::vector<bool> values;
+    bool evaluated = false;
+    size_t recomputed = 0;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_INCREMENTAL_H
@@ -0,0 +1,331 @@
+//
+// Created by illfate on 4/12/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_KERNELS_H
+#define BOOLEAN_EXPRESSION_COMPILER_KERNELS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include "row_patterns.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BEC_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+enum class Kernel {
+    AUTO,
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+// Rows evaluated together by one block: 64 words, i.e. 4096 rows, so a block holds
+// 8 AVX-512 or 16 AVX2 vectors and the dispatch cost is amortized over all of them.
+constexpr size_t BLOCK_WORDS = 64;
+
+// WordKernels are the bitwise operations the evaluators apply to a block of rows.
+// dst may alias any of the operands.
+struct WordKernels {
+    Kernel kernel;
+    const char *name;
+
+    void (*copy)(uint64_t *dst, const uint64_t *src, size_t words);
+
+    void (*fill)(uint64_t *dst, uint64_t value, size_t words);
+
+    void (*not_op)(uint64_t *dst, const uint64_t *src, size_t words);
+
+    void (*and_op)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words);
+
+    void (*or_op)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words);
+
+    void (*implication_op)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words);
+
+    void (*equality_op)(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words);
+};
+
+namespace scalar_kernels {
+    void copy(uint64_t *dst, const uint64_t *src, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = src[i];
+    }
+
+    void fill(uint64_t *dst, uint64_t value, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = value;
+    }
+
+    void notOp(uint64_t *dst, const uint64_t *src, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = ~src[i];
+    }
+
+    void andOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = lhs[i] & rhs[i];
+    }
+
+    void orOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = lhs[i] | rhs[i];
+    }
+
+    void implicationOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = ~lhs[i] | rhs[i];
+    }
+
+    void equalityOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        for (size_t i = 0; i < words; ++i) dst[i] = ~(lhs[i] ^ rhs[i]);
+    }
+}
+
+#ifdef BEC_X86_KERNELS
+
+// The vector kernels process whole registers and leave the remaining words, if the
+// block is shorter than a register, to the scalar loop.
+namespace avx2_kernels {
+    constexpr size_t LANES = 4;
+
+    __attribute__((target("avx2")))
+    void copy(uint64_t *dst, const uint64_t *src, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_loadu_si256((const __m256i *) (src + i)));
+        }
+        scalar_kernels::copy(dst + i, src + i, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void fill(uint64_t *dst, uint64_t value, size_t words) {
+        size_t i = 0;
+        __m256i v = _mm256_set1_epi64x((long long) value);
+        for (; i + LANES <= words; i += LANES) {
+            _mm256_storeu_si256((__m256i *) (dst + i), v);
+        }
+        scalar_kernels::fill(dst + i, value, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void notOp(uint64_t *dst, const uint64_t *src, size_t words) {
+        size_t i = 0;
+        __m256i ones = _mm256_set1_epi64x(-1);
+        for (; i + LANES <= words; i += LANES) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (src + i));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(a, ones));
+        }
+        scalar_kernels::notOp(dst + i, src + i, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void andOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (lhs + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (rhs + i));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_and_si256(a, b));
+        }
+        scalar_kernels::andOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void orOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (lhs + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (rhs + i));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(a, b));
+        }
+        scalar_kernels::orOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void implicationOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        __m256i ones = _mm256_set1_epi64x(-1);
+        for (; i + LANES <= words; i += LANES) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (lhs + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (rhs + i));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_or_si256(_mm256_xor_si256(a, ones), b));
+        }
+        scalar_kernels::implicationOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx2")))
+    void equalityOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        __m256i ones = _mm256_set1_epi64x(-1);
+        for (; i + LANES <= words; i += LANES) {
+            __m256i a = _mm256_loadu_si256((const __m256i *) (lhs + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (rhs + i));
+            _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(_mm256_xor_si256(a, b), ones));
+        }
+        scalar_kernels::equalityOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+}
+
+// The AVX-512 kernels use vpternlog, so implication and equality are one instruction
+// per 512 rows as well.
+namespace avx512_kernels {
+    constexpr size_t LANES = 8;
+    // vpternlog truth tables for the operands (a, b, c) = (lhs, rhs, unused).
+    constexpr int TERNLOG_NOT_A = 0x0F;
+    constexpr int TERNLOG_NOT_A_OR_B = 0xCF;
+    constexpr int TERNLOG_A_XNOR_B = 0xC3;
+
+    __attribute__((target("avx512f")))
+    void copy(uint64_t *dst, const uint64_t *src, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+        }
+        scalar_kernels::copy(dst + i, src + i, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void fill(uint64_t *dst, uint64_t value, size_t words) {
+        size_t i = 0;
+        __m512i v = _mm512_set1_epi64((long long) value);
+        for (; i + LANES <= words; i += LANES) {
+            _mm512_storeu_si512(dst + i, v);
+        }
+        scalar_kernels::fill(dst + i, value, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void notOp(uint64_t *dst, const uint64_t *src, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m512i a = _mm512_loadu_si512(src + i);
+            _mm512_storeu_si512(dst + i, _mm512_ternarylogic_epi64(a, a, a, TERNLOG_NOT_A));
+        }
+        scalar_kernels::notOp(dst + i, src + i, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void andOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m512i a = _mm512_loadu_si512(lhs + i);
+            __m512i b = _mm512_loadu_si512(rhs + i);
+            _mm512_storeu_si512(dst + i, _mm512_and_si512(a, b));
+        }
+        scalar_kernels::andOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void orOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m512i a = _mm512_loadu_si512(lhs + i);
+            __m512i b = _mm512_loadu_si512(rhs + i);
+            _mm512_storeu_si512(dst + i, _mm512_or_si512(a, b));
+        }
+        scalar_kernels::orOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void implicationOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m512i a = _mm512_loadu_si512(lhs + i);
+            __m512i b = _mm512_loadu_si512(rhs + i);
+            _mm512_storeu_si512(dst + i, _mm512_ternarylogic_epi64(a, b, b, TERNLOG_NOT_A_OR_B));
+        }
+        scalar_kernels::implicationOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void equalityOp(uint64_t *dst, const uint64_t *lhs, const uint64_t *rhs, size_t words) {
+        size_t i = 0;
+        for (; i + LANES <= words; i += LANES) {
+            __m512i a = _mm512_loadu_si512(lhs + i);
+            __m512i b = _mm512_loadu_si512(rhs + i);
+            _mm512_storeu_si512(dst + i, _mm512_ternarylogic_epi64(a, b, b, TERNLOG_A_XNOR_B));
+        }
+        scalar_kernels::equalityOp(dst + i, lhs + i, rhs + i, words - i);
+    }
+}
+
+#endif
+
+const WordKernels SCALAR_KERNELS = {
+        Kernel::SCALAR, "scalar",
+        scalar_kernels::copy, scalar_kernels::fill, scalar_kernels::notOp, scalar_kernels::andOp,
+        scalar_kernels::orOp, scalar_kernels::implicationOp, scalar_kernels::equalityOp,
+};
+
+#ifdef BEC_X86_KERNELS
+const WordKernels AVX2_KERNELS = {
+        Kernel::AVX2, "avx2",
+        avx2_kernels::copy, avx2_kernels::fill, avx2_kernels::notOp, avx2_kernels::andOp,
+        avx2_kernels::orOp, avx2_kernels::implicationOp, avx2_kernels::equalityOp,
+};
+
+const WordKernels AVX512_KERNELS = {
+        Kernel::AVX512, "avx512",
+        avx512_kernels::copy, avx512_kernels::fill, avx512_kernels::notOp, avx512_kernels::andOp,
+        avx512_kernels::orOp, avx512_kernels::implicationOp, avx512_kernels::equalityOp,
+};
+#endif
+
+bool isKernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AUTO:
+        case Kernel::SCALAR:
+            return true;
+#ifdef BEC_X86_KERNELS
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Kernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+std::string kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::AUTO:
+            return "auto";
+        case Kernel::SCALAR:
+            return "scalar";
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::AVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+Kernel parseKernel(const std::string &name) {
+    for (auto kernel:{Kernel::AUTO, Kernel::SCALAR, Kernel::AVX2, Kernel::AVX512}) {
+        if (kernelName(kernel) == name) {
+            return kernel;
+        }
+    }
+    throw std::invalid_argument("unknown kernel: " + name);
+}
+
+// selectKernels returns the requested kernels, or the widest supported ones for AUTO.
+const WordKernels &selectKernels(Kernel kernel) {
+    if (!isKernelSupported(kernel)) {
+        throw std::invalid_argument("kernel " + kernelName(kernel) + " is not supported by this CPU");
+    }
+#ifdef BEC_X86_KERNELS
+    if (kernel == Kernel::AUTO) {
+        kernel = isKernelSupported(Kernel::AVX512) ? Kernel::AVX512
+                                                   : isKernelSupported(Kernel::AVX2) ? Kernel::AVX2 : Kernel::SCALAR;
+    }
+    if (kernel == Kernel::AVX512) {
+        return AVX512_KERNELS;
+    }
+    if (kernel == Kernel::AVX2) {
+        return AVX2_KERNELS;
+    }
+#endif
+    return SCALAR_KERNELS;
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_KERNELS_H
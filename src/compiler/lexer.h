@@ -6,84 +6,130 @@
 #define INC_1LAB_LEXER_H
 
 #include <string>
+#include <string_view>
+#include <iterator>
 #include <utility>
 #include <unordered_map>
 #include <unordered_set>
 #include <sstream>
-#include <cassert>
+#include <optional>
 #include <functional>
 #include <memory>
+#include "diagnostic.h"
 #include "symbol_table.h"
 #include "token.h"
+#include "mapped_file.h"
 
+// Lexer scans a contiguous buffer with a plain cursor. The buffer is either borrowed
+// (string_view), owned by the lexer (strings and streams, which are read once up front)
+// or a mapped file kept alive by the lexer. ended mirrors the eof bit of a stream: it is
+// set once a read hits the end of the buffer, or a malformed token. Malformed input does
+// not throw: GetNext returns an ERROR token and Error tells what went wrong and where.
 class Lexer {
 public:
-    explicit Lexer(const std::string &str, const std::shared_ptr<SymbolTable> &symbol_table) : symbol_table(
-            symbol_table) {
-        symbol_stream = std::make_unique<std::istringstream>(std::istringstream(str));
-    }
+    explicit Lexer(std::string_view source, const std::shared_ptr<SymbolTable> &symbol_table)
+            : source(source), symbol_table(symbol_table) {}
+
+    explicit Lexer(const char *str, const std::shared_ptr<SymbolTable> &symbol_table)
+            : Lexer(std::string(str), symbol_table) {}
+
+    explicit Lexer(const std::string &str, const std::shared_ptr<SymbolTable> &symbol_table)
+            : Lexer(std::make_shared<const std::string>(str), symbol_table) {}
 
     explicit Lexer(std::unique_ptr<std::istream> &&ss, const std::shared_ptr<SymbolTable> &symbol_table)
-            : symbol_stream(std::move(ss)), symbol_table(symbol_table) {
+            : Lexer(std::make_shared<const std::string>(std::istreambuf_iterator<char>(*ss),
+                                                        std::istreambuf_iterator<char>()), symbol_table) {}
+
+    explicit Lexer(const std::shared_ptr<const MappedFile> &file, const std::shared_ptr<SymbolTable> &symbol_table)
+            : storage(file), source(file->View()), symbol_table(symbol_table) {}
+
+    // Reset starts lexing source, a buffer borrowed like in the string_view constructor.
+    void Reset(std::string_view source) {
+        storage.reset();
+        this->source = source;
+        cursor = 0;
+        ended = false;
+        error.reset();
+        id_counter = 0;
     }
 
     Token GetNext() {
-        auto token = getNext();
-        symbol_table->SetToken(token.id, token);
-        return token;
+        return getNext();
     }
 
-    Token LookupNext() {
-        auto[type, value] = lookupNext();
-        int64_t pos = symbol_stream->tellg();
-        Token token{.type=type, .position=pos, .value=value};
-        return token;
+    Token LookupNext() const {
+        return lookupNext();
     }
 
     bool IsEmpty() const {
-        return symbol_stream->eof();
+        return ended;
+    }
+
+    // Error is why the last ERROR token was returned. After an error the input is over.
+    const std::optional<Diagnostic> &Error() const {
+        return error;
+    }
+
+    // Tokens is the number of tokens GetNext returned since the last Reset.
+    size_t Tokens() const {
+        return id_counter;
     }
 
 private:
+    Lexer(const std::shared_ptr<const std::string> &str, const std::shared_ptr<SymbolTable> &symbol_table)
+            : storage(str), source(*str), symbol_table(symbol_table) {}
+
     Token getNext() {
-        if (symbol_stream->eof()) {
-            throw std::runtime_error("unexpected eof");
+        if (ended) {
+            return fail(ErrorCode::UNEXPECTED_EOF, -1, "unexpected eof");
+        }
+        char token = get();
+        int64_t pos = tell();
+        while (token == ' ' || token == '\n') {
+            if (peek() == END) {
+                return fail(ErrorCode::UNEXPECTED_EOF, pos, "unexpected eof");
+            }
+            token = get();
+            pos = tell();
         }
-        char token = symbol_stream->get();
-        int64_t pos = symbol_stream->tellg();
 
-        TokenType type;
-        char next = symbol_stream->peek();
+        TokenType type = TokenType::END_OF_INPUT;
+        char next = peek();
 
         auto opt_type = getBaseTokenType(token, pos);
         if (!opt_type) {
             if (token == '-') {
-                assert(next == '>');
-                symbol_stream->ignore();
+                if (next != '>') {
+                    return incomplete("->", pos);
+                }
+                ignore();
                 type = TokenType::IMPLICATION;
             } else if (token == 'l') {
-                assert(next == 'e');
-                symbol_stream->ignore();
-                token = symbol_stream->get();
-                assert(token == 't');
-
-                next = symbol_stream->peek();
-                assert(next == ' ');
+                if (next != 'e') {
+                    return incomplete("let", pos);
+                }
+                ignore();
+                token = get();
+                if (token != 't' || peek() != ' ') {
+                    return incomplete("let", pos);
+                }
                 type = TokenType::IDENTIFIER_OPERATOR;
-            } else if (token == ' ' || token == '\n') {
-                return getNext();
             } else if (token == '/') {
-                assert(next == '\\');
-                symbol_stream->ignore();
+                if (next != '\\') {
+                    return incomplete("/\\", pos);
+                }
+                ignore();
                 type = TokenType::AND_OPERATOR;
             } else if (token == '\\') {
-                assert(next == '/');
-                symbol_stream->ignore();
+                if (next != '/') {
+                    return incomplete("\\/", pos);
+                }
+                ignore();
                 type = TokenType::OR_OPERATOR;
-            } else if (token != '\0' && token != -1) {
+            } else if (token != '\0' && token != END) {
                 std::stringstream ss;
                 ss << "unsupported type: " << token << " at position " << std::to_string(pos);
-                throw std::invalid_argument(ss.str());
+                return fail(ErrorCode::UNSUPPORTED_CHARACTER, pos, ss.str());
             }
         } else {
             type = opt_type.value();
@@ -92,43 +138,81 @@ private:
         return res_token;
     }
 
-    std::pair<TokenType, std::string> lookupNext() {
-        char token = symbol_stream->peek();
+    // fail records a malformed token and ends the input, the token it returns is an
+    // ERROR token at position.
+    Token fail(ErrorCode code, int64_t position, std::string message) {
+        error = Diagnostic{code, {position, position == -1 ? 0 : 1}, std::move(message)};
+        ended = true;
+        return {.type=TokenType::ERROR, .id=id_counter, .position=position, .value={}};
+    }
 
-        size_t pos = symbol_stream->tellg();
-        symbol_stream->seekg(pos + 1);
-        TokenType type;
-        char next = symbol_stream->peek();
-        symbol_stream->seekg(pos);
+    Token incomplete(const std::string &expected, int64_t position) {
+        return fail(ErrorCode::INCOMPLETE_OPERATOR, position,
+                    "expected " + expected + " at position " + std::to_string(position));
+    }
+
+    // lookupNext classifies the next token without consuming it, not even the whitespace
+    // before it, so the tokens GetNext returns do not depend on lookups. A malformed token
+    // is an ERROR, the GetNext that reads it reports why.
+    Token lookupNext() const {
+        size_t pos = cursor;
+        while (pos < source.size() && (source[pos] == ' ' || source[pos] == '\n')) {
+            ++pos;
+        }
+        char token = pos < source.size() ? source[pos] : END;
+        char next = pos + 1 < source.size() ? source[pos + 1] : END;
+        TokenType type = TokenType::END_OF_INPUT;
 
         auto opt_type = getBaseTokenType(token, pos);
         if (!opt_type) {
             if (token == '-') {
-                assert(next == '>');
-                type = TokenType::IMPLICATION;
-            } else if (token == ' ' || token == '\n') {
-                symbol_stream->ignore();
-                return lookupNext();
+                type = next == '>' ? TokenType::IMPLICATION : TokenType::ERROR;
             } else if (token == '/') {
-                assert(next == '\\');
-                type = TokenType::AND_OPERATOR;
+                type = next == '\\' ? TokenType::AND_OPERATOR : TokenType::ERROR;
             } else if (token == '\\') {
-                assert(next == '/');
-                type = TokenType::OR_OPERATOR;
-            } else if (token != '\0' && token != -1) {
-                std::string err_msg = "unsupported type: ";
-                err_msg += token;
-                err_msg += " at position ";
-                err_msg += std::to_string(pos);
-                throw std::invalid_argument(err_msg);
+                type = next == '/' ? TokenType::OR_OPERATOR : TokenType::ERROR;
+            } else if (token != '\0' && token != END) {
+                type = TokenType::ERROR;
             }
         } else {
             type = opt_type.value();
         }
-        return {type, {token}};
+        // positions count from 1, like the ones of GetNext
+        int64_t position = pos < source.size() ? int64_t(pos) + 1 : -1;
+        return {.type=type, .id=id_counter, .position=position, .value={token}};
+    }
+
+    // get, peek and ignore behave like their istream namesakes, END stands for EOF.
+    char get() {
+        if (cursor < source.size()) {
+            return source[cursor++];
+        }
+        ended = true;
+        return END;
+    }
+
+    char peek() {
+        if (cursor < source.size()) {
+            return source[cursor];
+        }
+        ended = true;
+        return END;
+    }
+
+    void ignore() {
+        if (cursor < source.size()) {
+            ++cursor;
+        } else {
+            ended = true;
+        }
+    }
+
+    // tell is the offset of the cursor, or -1 once the end was hit, like tellg.
+    int64_t tell() const {
+        return ended ? -1 : int64_t(cursor);
     }
 
-    std::optional<TokenType> getBaseTokenType(char symbol, int64_t pos) {
+    static std::optional<TokenType> getBaseTokenType(char symbol, int64_t pos) {
         switch (symbol) {
             case '(':
                 return TokenType::OPEN_BRACKET;
@@ -157,10 +241,14 @@ private:
         return {};
     }
 
-    size_t
+    static constexpr char END = std::char_traits<char>::eof();
 
-            id_counter = 0;
-    std::unique_ptr<std::istream> symbol_stream;
+    size_t id_counter = 0;
+    std::shared_ptr<const void> storage;
+    std::string_view source;
+    size_t cursor = 0;
+    bool ended = false;
+    std::optional<Diagnostic> error;
     std::shared_ptr<SymbolTable> symbol_table;
 };
 
@@ -0,0 +1,70 @@
+//
+// Created by illfate on 4/26/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_MAPPED_FILE_H
+#define BOOLEAN_EXPRESSION_COMPILER_MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MappedFile maps a whole file read-only into memory and unmaps it on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("can't open " + path + ": " + std::strerror(errno));
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("can't stat " + path + ": " + std::strerror(errno));
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("can't mmap " + path + ": " + std::strerror(errno));
+            }
+            data = static_cast<const char *>(mapped);
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (data) {
+            ::munmap(const_cast<char *>(data), size);
+        }
+    }
+
+    const char *Data() const {
+        return data;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+
+    std::string_view View() const {
+        return {data, size};
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_MAPPED_FILE_H
@@ -0,0 +1,325 @@
+//
+// Created by illfate on 5/8/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_MINIMIZER_H
+#define BOOLEAN_EXPRESSION_COMPILER_MINIMIZER_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "bdd.h"
+#include "bit_vector.h"
+#include "row_patterns.h"
+
+// Cube is an elementary conjunction: variable j occurs in it if bit j of mask is set,
+// negated unless bit j of bits is set as well.
+struct Cube {
+    uint64_t mask = 0;
+    uint64_t bits = 0;
+
+    bool operator==(const Cube &other) const = default;
+
+    size_t Literals() const {
+        return std::popcount(mask);
+    }
+
+    // Contains tells whether every row of other is a row of this cube.
+    bool Contains(const Cube &other) const {
+        return (mask & ~other.mask) == 0 && (other.bits & mask) == bits;
+    }
+};
+
+// Cover is a disjunction of cubes over named variables, variable j is variables[j].
+struct Cover {
+    std::vector<std::string> variables;
+    std::vector<Cube> cubes;
+
+    size_t Literals() const {
+        size_t literals = 0;
+        for (const auto &cube:cubes) {
+            literals += cube.Literals();
+        }
+        return literals;
+    }
+
+    // Formula writes the cover in the input syntax, every binary operation in its own
+    // parentheses and the operands of a chain grouped from the left.
+    std::string Formula() const {
+        if (cubes.empty()) {
+            return "0";
+        }
+        std::string disjunction;
+        for (size_t i = 0; i < cubes.size(); ++i) {
+            std::string conjunction;
+            size_t literals = 0;
+            for (uint32_t j = 0; j < variables.size(); ++j) {
+                if (!((cubes[i].mask >> j) & 1)) {
+                    continue;
+                }
+                std::string literal = (cubes[i].bits >> j) & 1 ? variables[j] : "(!" + variables[j] + ")";
+                conjunction = literals++ == 0 ? literal : "(" + conjunction + "/\\" + literal + ")";
+            }
+            if (literals == 0) {
+                conjunction = "1";
+            }
+            disjunction = i == 0 ? conjunction : "(" + disjunction + "\\/" + conjunction + ")";
+        }
+        return disjunction;
+    }
+};
+
+// QM_MAX_VARIABLES is the largest number of variables minimizeTable accepts; beyond it
+// the prime implicants are too many to enumerate.
+constexpr uint32_t QM_MAX_VARIABLES = 12;
+
+// sortCubes orders cubes by their literals in variable order, positive before negative
+// before absent, so the printed cover does not depend on the search order.
+void sortCubes(std::vector<Cube> &cubes, uint32_t variables) {
+    auto rank = [](const Cube &cube, uint32_t j) {
+        return !((cube.mask >> j) & 1) ? 2 : ((cube.bits >> j) & 1 ? 0 : 1);
+    };
+    std::ranges::sort(cubes, [&](const Cube &lhs, const Cube &rhs) {
+        for (uint32_t j = 0; j < variables; ++j) {
+            if (rank(lhs, j) != rank(rhs, j)) {
+                return rank(lhs, j) < rank(rhs, j);
+            }
+        }
+        return false;
+    });
+}
+
+// cubeRows returns the rows of cube as a packed truth table column.
+std::vector<uint64_t> cubeRows(const Cube &cube, uint32_t variables) {
+    size_t rows = size_t(1) << variables;
+    std::vector<uint64_t> words(wordsForRows(rows));
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t word = rows < ROWS_PER_WORD ? (uint64_t(1) << rows) - 1 : ~uint64_t(0);
+        for (uint32_t j = 0; j < variables; ++j) {
+            if ((cube.mask >> j) & 1) {
+                word &= (cube.bits >> j) & 1 ? rowPattern(j, w) : ~rowPattern(j, w);
+            }
+        }
+        words[w] = word;
+    }
+    return words;
+}
+
+// primeImplicants merges the rows of table into ever larger cubes, as in Quine-McCluskey:
+// two cubes with the same mask that differ in one bit merge into a cube without that
+// variable, and a cube that merges with none is prime.
+std::vector<Cube> primeImplicants(const BitVector &table, uint32_t variables) {
+    auto key = [](const Cube &cube) {
+        return (cube.mask << 32) | cube.bits;
+    };
+    uint64_t full_mask = (uint64_t(1) << variables) - 1;
+    std::vector<Cube> current;
+    for (size_t row = 0; row < table.Size(); ++row) {
+        if (table[row]) {
+            current.push_back({full_mask, row});
+        }
+    }
+    std::vector<Cube> primes;
+    while (!current.empty()) {
+        std::unordered_set<uint64_t> present;
+        for (const auto &cube:current) {
+            present.insert(key(cube));
+        }
+        std::unordered_set<uint64_t> merged_keys;
+        std::vector<Cube> next;
+        for (const auto &cube:current) {
+            bool merged = false;
+            for (uint64_t rest = cube.mask; rest != 0; rest &= rest - 1) {
+                uint64_t bit = rest & -rest;
+                if (!present.contains(key({cube.mask, cube.bits ^ bit}))) {
+                    continue;
+                }
+                merged = true;
+                Cube bigger{cube.mask & ~bit, cube.bits & ~bit};
+                if (merged_keys.insert(key(bigger)).second) {
+                    next.push_back(bigger);
+                }
+            }
+            if (!merged) {
+                primes.push_back(cube);
+            }
+        }
+        current = std::move(next);
+    }
+    return primes;
+}
+
+// minimizeTable returns a minimal or near-minimal cover of the rows of table. All prime
+// implicants are enumerated, the essential ones are taken, the rest of the rows are
+// covered greedily by the prime covering most of them, and primes that the others
+// cover after all are dropped.
+std::vector<Cube> minimizeTable(const BitVector &table, uint32_t variables) {
+    if (variables > QM_MAX_VARIABLES) {
+        throw std::invalid_argument("too many variables to enumerate prime implicants: " +
+                                    std::to_string(variables));
+    }
+    auto primes = primeImplicants(table, variables);
+    std::vector<std::vector<uint64_t>> rows;
+    for (const auto &prime:primes) {
+        rows.push_back(cubeRows(prime, variables));
+    }
+    std::vector<uint64_t> uncovered(table.Words().begin(), table.Words().end());
+    std::vector<bool> chosen(primes.size());
+    auto choose = [&](size_t p) {
+        chosen[p] = true;
+        for (size_t w = 0; w < uncovered.size(); ++w) {
+            uncovered[w] &= ~rows[p][w];
+        }
+    };
+
+    for (size_t row = 0; row < table.Size(); ++row) {
+        if (!((uncovered[row / ROWS_PER_WORD] >> (row % ROWS_PER_WORD)) & 1)) {
+            continue;
+        }
+        size_t covering = 0;
+        size_t only = 0;
+        for (size_t p = 0; p < primes.size() && covering < 2; ++p) {
+            if ((rows[p][row / ROWS_PER_WORD] >> (row % ROWS_PER_WORD)) & 1) {
+                ++covering;
+                only = p;
+            }
+        }
+        if (covering == 1) {
+            choose(only);
+        }
+    }
+
+    while (std::ranges::any_of(uncovered, [](uint64_t word) { return word != 0; })) {
+        size_t best = 0;
+        size_t best_rows = 0;
+        for (size_t p = 0; p < primes.size(); ++p) {
+            size_t covered = 0;
+            for (size_t w = 0; w < uncovered.size(); ++w) {
+                covered += std::popcount(uncovered[w] & rows[p][w]);
+            }
+            if (covered > best_rows ||
+                (covered == best_rows && covered > 0 && primes[p].Literals() < primes[best].Literals())) {
+                best = p;
+                best_rows = covered;
+            }
+        }
+        choose(best);
+    }
+
+    std::vector<size_t> cover;
+    for (size_t p = 0; p < primes.size(); ++p) {
+        if (chosen[p]) {
+            cover.push_back(p);
+        }
+    }
+    // a prime taken early may be covered by the ones taken after it
+    std::vector<Cube> cubes;
+    for (size_t i = cover.size(); i-- > 0;) {
+        std::vector<uint64_t> others(uncovered.size());
+        for (size_t p:cover) {
+            if (p != cover[i] && chosen[p]) {
+                for (size_t w = 0; w < others.size(); ++w) {
+                    others[w] |= rows[p][w];
+                }
+            }
+        }
+        bool redundant = true;
+        for (size_t w = 0; w < others.size(); ++w) {
+            redundant = redundant && (rows[cover[i]][w] & ~others[w]) == 0;
+        }
+        if (redundant) {
+            chosen[cover[i]] = false;
+        }
+    }
+    for (size_t p:cover) {
+        if (chosen[p]) {
+            cubes.push_back(primes[p]);
+        }
+    }
+    sortCubes(cubes, variables);
+    return cubes;
+}
+
+// minimizeBdd returns a near-minimal cover of f in the manner of Espresso, for functions
+// of too many variables to enumerate their primes. The paths of the BDD to the true
+// terminal form the first cover. EXPAND drops every literal of a cube whose removal
+// keeps it inside f, making it prime, and the cubes other cubes contain are dropped.
+// IRREDUNDANT then removes the cubes the rest of the cover covers. Containment is
+// checked on the BDD, so no rows are enumerated.
+std::vector<Cube> minimizeBdd(BddManager &manager, BddRef f) {
+    std::vector<Cube> cubes;
+    std::vector<std::pair<BddRef, Cube>> stack{{f, Cube{}}};
+    while (!stack.empty()) {
+        auto[node, cube] = stack.back();
+        stack.pop_back();
+        if (node == BDD_TRUE) {
+            cubes.push_back(cube);
+            continue;
+        }
+        if (node == BDD_FALSE) {
+            continue;
+        }
+        uint64_t bit = uint64_t(1) << manager[node].var;
+        stack.emplace_back(manager[node].low, Cube{cube.mask | bit, cube.bits});
+        stack.emplace_back(manager[node].high, Cube{cube.mask | bit, cube.bits | bit});
+    }
+
+    auto cubeBdd = [&](const Cube &cube) {
+        BddRef g = BDD_TRUE;
+        for (uint64_t rest = cube.mask; rest != 0; rest &= rest - 1) {
+            uint32_t var = std::countr_zero(rest);
+            BddRef literal = manager.Var(var);
+            g = manager.And(g, (cube.bits >> var) & 1 ? literal : manager.Not(literal));
+        }
+        return g;
+    };
+    auto implies = [&](BddRef g, BddRef h) {
+        return manager.Implication(g, h) == BDD_TRUE;
+    };
+
+    // EXPAND, the smallest cubes first, they have the most literals to lose
+    std::ranges::sort(cubes, [](const Cube &lhs, const Cube &rhs) {
+        return lhs.Literals() < rhs.Literals();
+    });
+    std::vector<Cube> expanded;
+    for (auto cube:cubes) {
+        if (std::ranges::any_of(expanded, [&](const Cube &prime) { return prime.Contains(cube); })) {
+            continue;
+        }
+        for (uint64_t rest = cube.mask; rest != 0; rest &= rest - 1) {
+            uint64_t bit = rest & -rest;
+            Cube bigger{cube.mask & ~bit, cube.bits & ~bit};
+            if (implies(cubeBdd(bigger), f)) {
+                cube = bigger;
+            }
+        }
+        std::erase_if(expanded, [&](const Cube &prime) { return cube.Contains(prime); });
+        expanded.push_back(cube);
+    }
+
+    // IRREDUNDANT, the cubes with the most literals are tried first
+    std::ranges::sort(expanded, [](const Cube &lhs, const Cube &rhs) {
+        return lhs.Literals() > rhs.Literals();
+    });
+    std::vector<BddRef> suffix(expanded.size() + 1, BDD_FALSE);
+    for (size_t i = expanded.size(); i-- > 0;) {
+        suffix[i] = manager.Or(cubeBdd(expanded[i]), suffix[i + 1]);
+    }
+    std::vector<Cube> irredundant;
+    BddRef kept = BDD_FALSE;
+    for (size_t i = 0; i < expanded.size(); ++i) {
+        BddRef cube = cubeBdd(expanded[i]);
+        if (implies(cube, manager.Or(kept, suffix[i + 1]))) {
+            continue;
+        }
+        irredundant.push_back(expanded[i]);
+        kept = manager.Or(kept, cube);
+    }
+    sortCubes(irredundant, manager.Variables());
+    return irredundant;
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_MINIMIZER_H
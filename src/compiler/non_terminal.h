@@ -5,6 +5,8 @@
 #ifndef INC_1LAB_NON_TERMINAL_H
 #define INC_1LAB_NON_TERMINAL_H
 
+#include <memory>
+#include <vector>
 #include "expression.h"
 
 class NonTerminal : public BooleanExpression {
@@ -15,6 +17,22 @@ protected:
 public:
     NonTerminal() {}
 
+    // The destructor unlinks the subtrees it owns alone and releases them from a local
+    // stack, so dropping a deep tree does not recurse through the child destructors.
+    ~NonTerminal() override {
+        std::vector<std::shared_ptr<BooleanExpression>> pending;
+        detachChildren(pending);
+        while (!pending.empty()) {
+            auto expression = std::move(pending.back());
+            pending.pop_back();
+            if (expression.use_count() == 1) {
+                if (auto non_terminal = dynamic_cast<NonTerminal *>(expression.get())) {
+                    non_terminal->detachChildren(pending);
+                }
+            }
+        }
+    }
+
     virtual std::string string() const = 0;
 
     virtual bool interpret() const = 0;
@@ -32,6 +50,16 @@ public:
     const std::shared_ptr<BooleanExpression> &GetLeft() const { return left; }
 
     virtual TokenType getTokenType() const = 0;
+
+private:
+    void detachChildren(std::vector<std::shared_ptr<BooleanExpression>> &pending) {
+        if (left) {
+            pending.push_back(std::move(left));
+        }
+        if (right) {
+            pending.push_back(std::move(right));
+        }
+    }
 };
 
 class OrOperation : public NonTerminal {
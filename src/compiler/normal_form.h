@@ -0,0 +1,78 @@
+//
+// Created by illfate on 5/9/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_NORMAL_FORM_H
+#define BOOLEAN_EXPRESSION_COMPILER_NORMAL_FORM_H
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class NormalForm {
+    // PDNF is the disjunction of the minterms of the rows where the formula is 1.
+    PDNF,
+    // PCNF is the conjunction of the maxterms of the rows where the formula is 0.
+    PCNF,
+};
+
+// NormalFormWriter prints a perfect normal form in the input syntax one term at a time,
+// so a form with millions of terms is never held in memory. The chain of terms is
+// grouped from the right, (t1\/(t2\/t3)), which only leaves closing parentheses for
+// Finish; the literals inside a term are grouped from the left.
+class NormalFormWriter {
+public:
+    NormalFormWriter(std::ostream &os, const std::vector<std::string> &variables, NormalForm form)
+            : os(os), form(form) {
+        for (const auto &variable:variables) {
+            positive.push_back(variable);
+            negative.push_back("(!" + variable + ")");
+        }
+    }
+
+    // WriteTerm writes the term of row i, bit j of i is the value of variable j.
+    void WriteTerm(size_t row) {
+        if (terms++ > 0) {
+            os << "(" << pending << (form == NormalForm::PDNF ? "\\/" : "/\\");
+        }
+        if (positive.empty()) {
+            pending = form == NormalForm::PDNF ? "1" : "0";
+            return;
+        }
+        pending.assign(positive.size() - 1, '(');
+        for (size_t j = 0; j < positive.size(); ++j) {
+            bool value = (row >> j) & 1;
+            // a maxterm is false exactly on its row, so its literals are inverted
+            const auto &literal = value == (form == NormalForm::PDNF) ? positive[j] : negative[j];
+            if (j == 0) {
+                pending += literal;
+            } else {
+                pending.append(form == NormalForm::PDNF ? "/\\" : "\\/").append(literal).append(")");
+            }
+        }
+    }
+
+    // Finish closes the chain. Without terms the form is the constant it stands for.
+    void Finish() {
+        if (terms == 0) {
+            os << (form == NormalForm::PDNF ? "0" : "1");
+            return;
+        }
+        os << pending << std::string(terms - 1, ')');
+    }
+
+    size_t Terms() const {
+        return terms;
+    }
+
+private:
+    std::ostream &os;
+    NormalForm form;
+    std::vector<std::string> positive;
+    std::vector<std::string> negative;
+    std::string pending;
+    size_t terms = 0;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_NORMAL_FORM_H
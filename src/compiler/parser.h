@@ -7,65 +7,109 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 #include "non_terminal.h"
 #include "terminal.h"
 #include "lexer.h"
+#include "ast.h"
+#include "simplifier.h"
+#include "stats.h"
 
-void traverseNodes(std::string &sb, const std::string &padding,
-                   const std::string &edge,
-                   const std::shared_ptr<BooleanExpression> &node,
-                   bool has_right) {
-    if (!node) {
-        return;
-    }
-    sb += "\n" + padding + edge + node->string();
-
-    std::string new_padding(padding);
-    if (has_right) {
-        new_padding.append("│  ");
-    } else {
-        new_padding.append("   ");
+std::string nodeString(const Ast &ast, uint32_t index) {
+    const auto &node = ast[index];
+    switch (node.type) {
+        case TokenType::SYMBOL:
+            return ast.Symbol(node.symbol);
+        case TokenType::CONSTANT:
+            return std::to_string(node.symbol);
+        case TokenType::NOT_OPERATOR:
+            return "NOT";
+        case TokenType::AND_OPERATOR:
+            return "AND";
+        case TokenType::OR_OPERATOR:
+            return "OR";
+        case TokenType::IMPLICATION:
+            return "IMPLICATION";
+        case TokenType::EQUALITY:
+            return "EQUALITY";
+        default:
+            return "";
     }
+}
 
-    auto terminal = std::dynamic_pointer_cast<Terminal>(node);
-    if (terminal) {
-        return;
+// debugChildren returns the children in the order the tree is printed, NOT_OPERATOR
+// prints its child as the right edge like the other unary nodes did.
+std::pair<uint32_t, uint32_t> debugChildren(const AstNode &node) {
+    if (node.type == TokenType::NOT_OPERATOR) {
+        return {NO_NODE, node.left};
     }
-    auto non_terminal = std::dynamic_pointer_cast<NonTerminal>(node);
+    return {node.left, node.right};
+}
 
-    std::string right_edge = "└──";
-    std::string left_edge =
-            (non_terminal->GetRight() != nullptr) ? "├──" : "└──";
+// traverseNodes prints the subtree at index in pre-order. Pending nodes are kept on an
+// explicit stack; they share one padding string, a pending node only remembers the
+// length of its padding, since the nodes printed before it only change what follows.
+void traverseNodes(std::string &sb, const std::string &padding,
+                   const std::string &edge,
+                   const Ast &ast, uint32_t index,
+                   bool has_right) {
+    struct Pending {
+        uint32_t index;
+        size_t padding_size;
+        const char *edge;
+        bool has_right;
+    };
+    std::string current_padding(padding);
+    std::vector<Pending> stack{{index, padding.size(), edge.c_str(), has_right}};
+    while (!stack.empty()) {
+        auto pending = stack.back();
+        stack.pop_back();
+        if (pending.index == NO_NODE) {
+            continue;
+        }
+        current_padding.resize(pending.padding_size);
+        sb += "\n";
+        sb += current_padding;
+        sb += pending.edge;
+        sb += nodeString(ast, pending.index);
 
-    traverseNodes(sb, new_padding, left_edge,
-                  non_terminal->GetLeft(),
-                  non_terminal->GetRight() != nullptr);
-    traverseNodes(sb, new_padding, right_edge,
-                  non_terminal->GetRight(), false);
+        const auto &node = ast[pending.index];
+        if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+            continue;
+        }
+        if (pending.has_right) {
+            current_padding.append("│  ");
+        } else {
+            current_padding.append("   ");
+        }
+        auto[left, right] = debugChildren(node);
+        const char *left_edge = (right != NO_NODE) ? "├──" : "└──";
+        stack.push_back({right, current_padding.size(), "└──", false});
+        stack.push_back({left, current_padding.size(), left_edge, right != NO_NODE});
+    }
 }
 
-void debugNode(std::ostream &os, const std::shared_ptr<BooleanExpression> &node) {
+void debugNode(std::ostream &os, const Ast &ast, uint32_t index) {
     std::string rightEdge = "└──";
-    auto terminal = std::dynamic_pointer_cast<Terminal>(node);
-    if (terminal) {
-        os << terminal->string() << "\n";
+    const auto &node = ast[index];
+    if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+        os << nodeString(ast, index) << "\n";
         return;
     }
-    auto non_terminal = std::dynamic_pointer_cast<NonTerminal>(node);
-    std::string leftEdge = (node != nullptr) ? "├──" : "└──";
+    std::string leftEdge = "├──";
 
     std::string res;
-    res += node->string();
-    auto right = non_terminal->GetRight();
-    traverseNodes(res, "", leftEdge, non_terminal->GetLeft(),
-                  right != nullptr);
-    traverseNodes(res, "", rightEdge, right, false);
+    res += nodeString(ast, index);
+    auto[left, right] = debugChildren(node);
+    traverseNodes(res, "", leftEdge, ast, left, right != NO_NODE);
+    traverseNodes(res, "", rightEdge, ast, right, false);
     os << res;
 }
 
 class Parser {
 private:
-    std::shared_ptr<BooleanExpression> root;
+    Ast ast;
+    uint32_t root = NO_NODE;
     std::unique_ptr<Lexer> lexer;
     Token token;
     std::shared_ptr<SymbolTable> symbol_table;
@@ -74,120 +118,288 @@ public:
     explicit Parser(std::unique_ptr<Lexer> &&lexer, const std::shared_ptr<SymbolTable> &symbol_table) : lexer(
             std::move(lexer)), symbol_table(symbol_table) {}
 
-    void build() {
-        factor();
-        if (!lexer->IsEmpty()) {
-            try {
-                token = lexer->GetNext();
-            } catch (const std::exception &exception) {
-                if (exception.what() == std::string("unexpected eof")) {
-                    return;
-                } else {
-                    throw std::invalid_argument(exception.what());
+    // Parse parses the formula into the arena. Malformed input does not throw: the first
+    // error is returned with its position, and the arena is left without a root.
+    std::optional<Diagnostic> Parse() {
+        error.reset();
+        if (!factor()) {
+            return error;
+        }
+        ast.SetRoot(root);
+        if (!inputEmpty()) {
+            token = lex();
+            if (token.type == TokenType::ERROR) {
+                // whitespace after the formula runs into the end of the input
+                if (lexer->Error()->code == ErrorCode::UNEXPECTED_EOF) {
+                    return {};
                 }
+                return lexer->Error();
             }
             std::stringstream ss;
             ss << "syntax error in your formula, unexpected identifier: " << token;
-            throw std::invalid_argument(ss.str());
+            fail(ErrorCode::TRAILING_INPUT, spanOf(token), ss.str());
         }
+        return error;
+    }
+
+    // build is Parse for callers that handle errors as exceptions.
+    void build() {
+        if (auto diagnostic = Parse()) {
+            throw std::invalid_argument(diagnostic->message);
+        }
+    }
+
+    // Simplify sets the evaluation root of the arena to the simplified formula, with the
+    // symbols bound by let folded in unless they are to be rebound later. It runs after
+    // build.
+    void Simplify(bool fold_bindings = true) {
+        std::vector<std::optional<bool>> symbol_values(ast.Symbols().size());
+        for (const auto &[token, constant]:symbol_table->getTokenToConstant()) {
+            auto id = ast.FindSymbol(token.value);
+            if (id && fold_bindings) {
+                symbol_values[id.value()] = constant.getValue();
+            }
+        }
+        ast.SetEvaluationRoot(Simplifier(ast, symbol_values).Simplify(ast.Root()));
+    }
+
+    // Reset prepares the parser for another formula. The arena keeps its capacity.
+    void Reset(std::string_view source) {
+        lexer->Reset(source);
+        block.clear();
+        lexed = 0;
+        ast.Clear();
+        root = NO_NODE;
     }
 
     void debug(std::ostream &os) {
-        debugNode(os, root);
+        debugNode(os, ast, root);
     }
 
+    // GetRoot materializes the parsed formula as a BooleanExpression tree.
     std::shared_ptr<BooleanExpression> GetRoot() const {
-        return root;
+        return ast.ToExpression(root);
+    }
+
+    const Ast &GetAst() const {
+        return ast;
+    }
+
+    size_t Tokens() const {
+        return lexer->Tokens();
+    }
+
+    // SetStats times lexing as the phase "lex" in the following parses. The tokens are then
+    // lexed LEX_BLOCK at a time ahead of the parser, so a block is timed as a whole and the
+    // phase the caller times the parse as leaves lexing out.
+    void SetStats(CompileStats *compile_stats) {
+        stats = compile_stats;
     }
 
 private:
-    void binaryFormula() {
-        factor();
-        token = lexer->GetNext();
-        assert((token.type == TokenType::OR_OPERATOR || token.type == TokenType::AND_OPERATOR) ||
-               token.type == TokenType::IMPLICATION || token.type == TokenType::EQUALITY);
-        handleBinaryFormula<OrOperation>();
-        handleBinaryFormula<AndOperation>();
-        handleBinaryFormula<ImplicationOperation>();
-        handleBinaryFormula<EqualityOperation>();
-    }
-
-    template<typename Operation>
-    void handleBinaryFormula() {
-        Operation op;
-        if (token.type == op.getTokenType()) {
-            auto operation = std::make_shared<Operation>();
-            operation->SetLeft(root);
-            factor();
-            token = lexer->GetNext();
-            operation->SetRight(root);
-            root = operation;
-            match(token, TokenType::CLOSE_BRACKET);
-        }
-    }
-
-    void unaryFormula() {
-        lexer->GetNext();
-        factor();
-        auto not_op = std::make_shared<NotOperation>(NotOperation());
-        not_op->SetChild(root);
-        root = not_op;
-        token = lexer->GetNext();
-        match(token, TokenType::CLOSE_BRACKET);
-    }
-
-    void handleFormula() {
-        TokenType next = lexer->LookupNext().type;
-        if (next == TokenType::NOT_OPERATOR) {
-            unaryFormula();
-        } else {
-            binaryFormula();
+    // Frame is a bracketed formula whose parsing waits for the factor being parsed. step
+    // tells what comes after that factor: the closing bracket of a negation, the operator
+    // of a binary formula, or the closing bracket of a binary formula whose left operand
+    // is left. begin is the position of its opening bracket.
+    enum class Step {
+        UNARY_CLOSE,
+        BINARY_OPERATOR,
+        BINARY_CLOSE,
+    };
+
+    struct Frame {
+        Step step;
+        TokenType type = TokenType::END_OF_INPUT;
+        uint32_t left = NO_NODE;
+        int64_t begin = -1;
+    };
+
+    // factor parses one factor into root. Nested formulas are kept on an explicit stack
+    // instead of the call stack, so the nesting depth is only bounded by memory. It returns
+    // false on an error, like the functions below, which is then in error.
+    bool factor() {
+        std::vector<Frame> stack;
+        while (true) {
+            bool opened = false;
+            if (!openFactor(opened)) {
+                return false;
+            }
+            if (opened) {
+                if (lookup().type == TokenType::NOT_OPERATOR) {
+                    lex();
+                    stack.push_back({.step=Step::UNARY_CLOSE, .begin=token.position});
+                } else {
+                    stack.push_back({.step=Step::BINARY_OPERATOR, .begin=token.position});
+                }
+                continue;
+            }
+            bool operand = false;
+            if (!closeFrames(stack, operand)) {
+                return false;
+            }
+            if (!operand) {
+                return true;
+            }
         }
-        match(token, TokenType::CLOSE_BRACKET);
     }
 
-    void factor() {
-        token = lexer->GetNext();
+    // openFactor reads the next factor. On an opening bracket it sets opened, otherwise
+    // the factor is a leaf and is stored in root.
+    bool openFactor(bool &opened) {
+        if (!next()) {
+            return false;
+        }
+        while (token.type == TokenType::IDENTIFIER_OPERATOR) {
+            if (!handleVariableInit() || !next()) {
+                return false;
+            }
+        }
         if (token.type == TokenType::OPEN_BRACKET) {
-            handleFormula();
+            opened = true;
         } else if (token.type == TokenType::SYMBOL) {
-            root = std::make_shared<Terminal>(Terminal(token.value));
+            root = ast.AddSymbol(token.value, spanOf(token));
         } else if (token.type == TokenType::CONSTANT) {
-            root = std::make_shared<Constant>(Constant(token.value));
-        } else if (token.type == TokenType::IDENTIFIER_OPERATOR) {
-            handleVariableInit();
+            root = ast.AddConstant(Constant(token.value).getValue(), spanOf(token));
         } else {
-            std::stringstream ss;
-            throw std::invalid_argument("unexpected type");
+            return fail(unexpected(token), spanOf(token), "unexpected type");
         }
+        return true;
     }
 
-    void handleVariableInit() {
-        token = lexer->GetNext();
-        match(token, TokenType::SYMBOL);
+    // closeFrames completes the frames waiting for root. It sets operand when the top
+    // frame needs another factor, the right operand of a binary formula.
+    bool closeFrames(std::vector<Frame> &stack, bool &operand) {
+        while (!stack.empty()) {
+            auto &frame = stack.back();
+            if (!next()) {
+                return false;
+            }
+            switch (frame.step) {
+                case Step::UNARY_CLOSE:
+                    root = ast.AddNot(root, bracketed(frame));
+                    break;
+                case Step::BINARY_OPERATOR:
+                    if (!isBinaryOperation(token.type)) {
+                        std::stringstream ss;
+                        ss << "unexpected type: " << "got: " << token << ", but want a binary operator\n";
+                        return fail(unexpected(token), spanOf(token), ss.str());
+                    }
+                    frame = {.step=Step::BINARY_CLOSE, .type=token.type, .left=root, .begin=frame.begin};
+                    operand = true;
+                    return true;
+                case Step::BINARY_CLOSE:
+                    root = ast.AddBinary(frame.type, frame.left, root, bracketed(frame));
+                    break;
+            }
+            if (!match(token, TokenType::CLOSE_BRACKET)) {
+                return false;
+            }
+            stack.pop_back();
+        }
+        return true;
+    }
 
+    // handleVariableInit reads the binding of a let, the factor it applies to follows.
+    bool handleVariableInit() {
+        if (!next() || !match(token, TokenType::SYMBOL)) {
+            return false;
+        }
         auto symbol = std::move(token);
-        token = lexer->GetNext();
-        match(token, TokenType::ASSIGNMENT_OPERATOR);
-
-        token = lexer->GetNext();
-        match(token, TokenType::CONSTANT);
+        if (!next() || !match(token, TokenType::ASSIGNMENT_OPERATOR)) {
+            return false;
+        }
+        if (!next() || !match(token, TokenType::CONSTANT)) {
+            return false;
+        }
         auto const_token = std::move(token);
-        token = lexer->GetNext();
-        match(token, TokenType::CLOSE_EXPRESSION_OPERATOR);
+        if (!next() || !match(token, TokenType::CLOSE_EXPRESSION_OPERATOR)) {
+            return false;
+        }
         symbol_table->SetTokenToConst(symbol, Constant(const_token.value));
-        factor();
+        return true;
+    }
+
+    // next reads the next token into token, a malformed one fails with the lexer's error.
+    bool next() {
+        token = lex();
+        if (token.type == TokenType::ERROR) {
+            error = lexer->Error();
+            return false;
+        }
+        return true;
     }
 
-    void match(const Token &got, TokenType want) {
+    // lex, lookup and inputEmpty read the tokens from the lexer, or with stats from the
+    // block lexed ahead.
+    Token lex() {
+        if (!stats) {
+            return lexer->GetNext();
+        }
+        if (lexed == block.size()) {
+            lexBlock();
+        }
+        return std::move(block[lexed++]);
+    }
+
+    Token lookup() {
+        if (!stats) {
+            return lexer->LookupNext();
+        }
+        if (lexed == block.size()) {
+            lexBlock();
+        }
+        return block[lexed];
+    }
+
+    bool inputEmpty() const {
+        return lexed == block.size() && lexer->IsEmpty();
+    }
+
+    // lexBlock lexes the next tokens up to the end of the input or a malformed token, which
+    // is the last one the lexer returns.
+    void lexBlock() {
+        CompileStats::Timer timer(stats, "lex");
+        block.clear();
+        lexed = 0;
+        do {
+            block.push_back(lexer->GetNext());
+        } while (block.size() < LEX_BLOCK && block.back().type != TokenType::ERROR && !lexer->IsEmpty());
+    }
+
+    bool match(const Token &got, TokenType want) {
         if (got.type != want) {
             std::stringstream ss;
             ss << "unexpected type: " << "got: " << got << ", bur want: " << want << "\n";
-            throw std::invalid_argument(ss.str());
+            return fail(unexpected(got), spanOf(got), ss.str());
         }
+        return true;
+    }
+
+    static ErrorCode unexpected(const Token &got) {
+        return got.type == TokenType::END_OF_INPUT ? ErrorCode::UNEXPECTED_EOF : ErrorCode::UNEXPECTED_TOKEN;
+    }
+
+    static SourceSpan spanOf(const Token &got) {
+        return {got.position, got.position == -1 ? 0 : tokenLength(got.type)};
+    }
+
+    // bracketed is the span from the opening bracket of frame to the closing bracket in
+    // token. A token that is no closing bracket fails the parse right after.
+    SourceSpan bracketed(const Frame &frame) const {
+        return {frame.begin, token.position == -1 ? 0 : token.position - frame.begin + 1};
+    }
+
+    bool fail(ErrorCode code, SourceSpan span, std::string message) {
+        error = Diagnostic{code, span, std::move(message)};
+        return false;
     }
 
+    static constexpr size_t LEX_BLOCK = 4096;
 
+    std::optional<Diagnostic> error;
+    CompileStats *stats = nullptr;
+    std::vector<Token> block;
+    size_t lexed = 0;
 };
 
 #endif //INC_1LAB_PARSER_H
@@ -0,0 +1,37 @@
+//
+// Created by illfate on 4/10/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_ROW_PATTERNS_H
+#define BOOLEAN_EXPRESSION_COMPILER_ROW_PATTERNS_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Row i of a truth table assigns bit j of i to the j-th variable. Packing 64 rows
+// into one word turns every variable into a fixed bit pattern: the first six
+// variables alternate inside a word, the others are constant over a whole word.
+constexpr uint64_t LOW_VARIABLE_PATTERNS[] = {
+        0xAAAAAAAAAAAAAAAAULL,
+        0xCCCCCCCCCCCCCCCCULL,
+        0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL,
+        0xFFFF0000FFFF0000ULL,
+        0xFFFFFFFF00000000ULL,
+};
+
+constexpr size_t ROWS_PER_WORD = 64;
+constexpr size_t LOW_VARIABLES = 6;
+
+inline uint64_t rowPattern(size_t variable, size_t word_index) {
+    if (variable < LOW_VARIABLES) {
+        return LOW_VARIABLE_PATTERNS[variable];
+    }
+    return ((word_index >> (variable - LOW_VARIABLES)) & 1) ? ~uint64_t(0) : 0;
+}
+
+inline size_t wordsForRows(size_t rows) {
+    return (rows + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_ROW_PATTERNS_H
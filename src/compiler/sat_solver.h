@@ -0,0 +1,492 @@
+//
+// Created by illfate on 5/6/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_SAT_SOLVER_H
+#define BOOLEAN_EXPRESSION_COMPILER_SAT_SOLVER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ast.h"
+
+// A Literal is variable * 2 for the variable and variable * 2 + 1 for its negation.
+using Literal = uint32_t;
+
+constexpr Literal makeLiteral(uint32_t var, bool negated = false) {
+    return var * 2 + negated;
+}
+
+constexpr Literal negate(Literal literal) {
+    return literal ^ 1;
+}
+
+constexpr uint32_t variableOf(Literal literal) {
+    return literal >> 1;
+}
+
+// VariableOrder is a binary max-heap of variables keyed by their activity, the
+// decision heuristic picks the most active unassigned variable from it.
+class VariableOrder {
+public:
+    explicit VariableOrder(const std::vector<double> &activity) : activity(activity) {}
+
+    bool Empty() const {
+        return heap.empty();
+    }
+
+    bool Contains(uint32_t var) const {
+        return var < position.size() && position[var] != NOT_IN_HEAP;
+    }
+
+    void Insert(uint32_t var) {
+        if (var >= position.size()) {
+            position.resize(var + 1, NOT_IN_HEAP);
+        }
+        if (Contains(var)) {
+            return;
+        }
+        position[var] = heap.size();
+        heap.push_back(var);
+        siftUp(position[var]);
+    }
+
+    // Increased restores the heap after the activity of var grew.
+    void Increased(uint32_t var) {
+        if (Contains(var)) {
+            siftUp(position[var]);
+        }
+    }
+
+    uint32_t PopMax() {
+        uint32_t top = heap.front();
+        position[top] = NOT_IN_HEAP;
+        heap.front() = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            position[heap.front()] = 0;
+            siftDown(0);
+        }
+        return top;
+    }
+
+private:
+    static constexpr size_t NOT_IN_HEAP = SIZE_MAX;
+
+    void siftUp(size_t i) {
+        uint32_t var = heap[i];
+        while (i > 0 && activity[heap[(i - 1) / 2]] < activity[var]) {
+            heap[i] = heap[(i - 1) / 2];
+            position[heap[i]] = i;
+            i = (i - 1) / 2;
+        }
+        heap[i] = var;
+        position[var] = i;
+    }
+
+    void siftDown(size_t i) {
+        uint32_t var = heap[i];
+        while (2 * i + 1 < heap.size()) {
+            size_t child = 2 * i + 1;
+            if (child + 1 < heap.size() && activity[heap[child]] < activity[heap[child + 1]]) {
+                ++child;
+            }
+            if (!(activity[var] < activity[heap[child]])) {
+                break;
+            }
+            heap[i] = heap[child];
+            position[heap[i]] = i;
+            i = child;
+        }
+        heap[i] = var;
+        position[var] = i;
+    }
+
+    const std::vector<double> &activity;
+    std::vector<uint32_t> heap;
+    std::vector<size_t> position;
+};
+
+// SatSolver is a conflict-driven clause learning solver over clauses in CNF. Clauses are
+// found through two watched literals each, a conflict adds its first-UIP clause and
+// jumps back to the second highest level in it, decisions follow the variable activity
+// with saved phases, and the search restarts on the Luby sequence.
+class SatSolver {
+public:
+    SatSolver() : order(activity) {}
+
+    uint32_t NewVariable() {
+        uint32_t var = values.size();
+        values.push_back(UNASSIGNED);
+        levels.push_back(0);
+        reasons.push_back(NO_CLAUSE);
+        phases.push_back(false);
+        seen.push_back(false);
+        activity.push_back(0);
+        watches.emplace_back();
+        watches.emplace_back();
+        order.Insert(var);
+        return var;
+    }
+
+    size_t Variables() const {
+        return values.size();
+    }
+
+    size_t Clauses() const {
+        return clauses.size();
+    }
+
+    size_t Conflicts() const {
+        return conflicts;
+    }
+
+    // AddClause adds a clause of the problem, before Solve is called.
+    void AddClause(std::vector<Literal> clause) {
+        std::ranges::sort(clause);
+        clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+        std::vector<Literal> literals;
+        for (size_t i = 0; i < clause.size(); ++i) {
+            if (variableOf(clause[i]) >= values.size()) {
+                throw std::invalid_argument("unknown sat variable: " + std::to_string(variableOf(clause[i])));
+            }
+            if (i + 1 < clause.size() && clause[i + 1] == negate(clause[i])) {
+                return;
+            }
+            if (value(clause[i]) == ASSIGNED_TRUE) {
+                return;
+            }
+            if (value(clause[i]) == UNASSIGNED) {
+                literals.push_back(clause[i]);
+            }
+        }
+        if (literals.empty()) {
+            unsatisfiable = true;
+        } else if (literals.size() == 1) {
+            assign(literals[0], NO_CLAUSE);
+        } else {
+            attach(std::move(literals));
+        }
+    }
+
+    // Solve tells whether the clauses are satisfiable, Model then holds an assignment.
+    bool Solve() {
+        if (unsatisfiable || propagate() != NO_CLAUSE) {
+            unsatisfiable = true;
+            return false;
+        }
+        uint64_t restart = 0;
+        uint64_t conflicts_until_restart = RESTART_BASE * luby(restart);
+        std::vector<Literal> learnt;
+        while (true) {
+            uint32_t conflict = propagate();
+            if (conflict != NO_CLAUSE) {
+                ++conflicts;
+                if (trail_limits.empty()) {
+                    unsatisfiable = true;
+                    return false;
+                }
+                uint32_t level = analyze(conflict, learnt);
+                backtrack(level);
+                if (learnt.size() == 1) {
+                    assign(learnt[0], NO_CLAUSE);
+                } else {
+                    assign(learnt[0], attach(learnt));
+                }
+                activity_increment /= ACTIVITY_DECAY;
+                if (--conflicts_until_restart == 0) {
+                    backtrack(0);
+                    conflicts_until_restart = RESTART_BASE * luby(++restart);
+                }
+                continue;
+            }
+            auto var = pickBranchVariable();
+            if (!var) {
+                model.assign(values.size(), false);
+                for (uint32_t v = 0; v < values.size(); ++v) {
+                    model[v] = values[v] == ASSIGNED_TRUE;
+                }
+                backtrack(0);
+                return true;
+            }
+            trail_limits.push_back(trail.size());
+            assign(makeLiteral(var.value(), !phases[var.value()]), NO_CLAUSE);
+        }
+    }
+
+    const std::vector<bool> &Model() const {
+        return model;
+    }
+
+private:
+    enum Value : int8_t {
+        ASSIGNED_FALSE = -1,
+        UNASSIGNED = 0,
+        ASSIGNED_TRUE = 1,
+    };
+
+    static constexpr uint32_t NO_CLAUSE = UINT32_MAX;
+    static constexpr uint64_t RESTART_BASE = 100;
+    static constexpr double ACTIVITY_DECAY = 0.95;
+    static constexpr double ACTIVITY_LIMIT = 1e100;
+
+    Value value(Literal literal) const {
+        Value var_value = values[variableOf(literal)];
+        return literal & 1 ? Value(-var_value) : var_value;
+    }
+
+    // attach stores a clause of two or more literals and watches its first two.
+    uint32_t attach(std::vector<Literal> literals) {
+        uint32_t index = clauses.size();
+        watches[literals[0]].push_back(index);
+        watches[literals[1]].push_back(index);
+        clauses.push_back(std::move(literals));
+        return index;
+    }
+
+    void assign(Literal literal, uint32_t reason) {
+        uint32_t var = variableOf(literal);
+        values[var] = literal & 1 ? ASSIGNED_FALSE : ASSIGNED_TRUE;
+        levels[var] = trail_limits.size();
+        reasons[var] = reason;
+        trail.push_back(literal);
+    }
+
+    // propagate assigns the literals implied by unit clauses and returns a clause that
+    // became false, or NO_CLAUSE. The literal a clause implies is kept first in it.
+    uint32_t propagate() {
+        while (propagated < trail.size()) {
+            Literal false_literal = negate(trail[propagated++]);
+            auto &watching = watches[false_literal];
+            size_t kept = 0;
+            for (size_t i = 0; i < watching.size(); ++i) {
+                uint32_t index = watching[i];
+                auto &literals = clauses[index];
+                if (literals[0] == false_literal) {
+                    std::swap(literals[0], literals[1]);
+                }
+                if (value(literals[0]) == ASSIGNED_TRUE) {
+                    watching[kept++] = index;
+                    continue;
+                }
+                bool moved = false;
+                for (size_t k = 2; k < literals.size(); ++k) {
+                    if (value(literals[k]) != ASSIGNED_FALSE) {
+                        std::swap(literals[1], literals[k]);
+                        watches[literals[1]].push_back(index);
+                        moved = true;
+                        break;
+                    }
+                }
+                if (moved) {
+                    continue;
+                }
+                watching[kept++] = index;
+                if (value(literals[0]) == ASSIGNED_FALSE) {
+                    std::copy(watching.begin() + i + 1, watching.end(), watching.begin() + kept);
+                    watching.resize(kept + watching.size() - i - 1);
+                    propagated = trail.size();
+                    return index;
+                }
+                assign(literals[0], index);
+            }
+            watching.resize(kept);
+        }
+        return NO_CLAUSE;
+    }
+
+    // analyze resolves the conflict back to the first unique implication point of the
+    // current level. learnt gets the asserting literal first and a literal of the level
+    // to jump back to second, the level is returned.
+    uint32_t analyze(uint32_t conflict, std::vector<Literal> &learnt) {
+        learnt.assign(1, 0);
+        uint32_t level = trail_limits.size();
+        size_t open = 0;
+        size_t index = trail.size();
+        Literal implied = 0;
+        bool first = true;
+        do {
+            const auto &literals = clauses[conflict];
+            for (size_t i = first ? 0 : 1; i < literals.size(); ++i) {
+                uint32_t var = variableOf(literals[i]);
+                if (seen[var] || levels[var] == 0) {
+                    continue;
+                }
+                seen[var] = true;
+                bump(var);
+                if (levels[var] == level) {
+                    ++open;
+                } else {
+                    learnt.push_back(literals[i]);
+                }
+            }
+            first = false;
+            while (!seen[variableOf(trail[--index])]) {}
+            implied = trail[index];
+            conflict = reasons[variableOf(implied)];
+            seen[variableOf(implied)] = false;
+        } while (--open > 0);
+        learnt[0] = negate(implied);
+
+        uint32_t back_level = 0;
+        for (size_t i = 1; i < learnt.size(); ++i) {
+            seen[variableOf(learnt[i])] = false;
+            if (levels[variableOf(learnt[i])] > back_level) {
+                back_level = levels[variableOf(learnt[i])];
+                std::swap(learnt[1], learnt[i]);
+            }
+        }
+        return back_level;
+    }
+
+    void bump(uint32_t var) {
+        activity[var] += activity_increment;
+        if (activity[var] > ACTIVITY_LIMIT) {
+            for (auto &a:activity) {
+                a /= ACTIVITY_LIMIT;
+            }
+            activity_increment /= ACTIVITY_LIMIT;
+        }
+        order.Increased(var);
+    }
+
+    void backtrack(uint32_t level) {
+        if (trail_limits.size() <= level) {
+            return;
+        }
+        for (size_t i = trail_limits[level]; i < trail.size(); ++i) {
+            uint32_t var = variableOf(trail[i]);
+            phases[var] = values[var] == ASSIGNED_TRUE;
+            values[var] = UNASSIGNED;
+            reasons[var] = NO_CLAUSE;
+            order.Insert(var);
+        }
+        trail.resize(trail_limits[level]);
+        trail_limits.resize(level);
+        propagated = trail.size();
+    }
+
+    std::optional<uint32_t> pickBranchVariable() {
+        while (!order.Empty()) {
+            uint32_t var = order.PopMax();
+            if (values[var] == UNASSIGNED) {
+                return var;
+            }
+        }
+        return {};
+    }
+
+    // luby returns the i-th element of 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+    static uint64_t luby(uint64_t i) {
+        uint64_t size = 1;
+        uint64_t power = 0;
+        while (size < i + 1) {
+            ++power;
+            size = 2 * size + 1;
+        }
+        while (size - 1 != i) {
+            size = (size - 1) / 2;
+            --power;
+            i %= size;
+        }
+        return uint64_t(1) << power;
+    }
+
+    std::vector<std::vector<Literal>> clauses;
+    std::vector<std::vector<uint32_t>> watches;
+    std::vector<Value> values;
+    std::vector<uint32_t> levels;
+    std::vector<uint32_t> reasons;
+    std::vector<bool> phases;
+    std::vector<bool> seen;
+    std::vector<double> activity;
+    double activity_increment = 1;
+    VariableOrder order;
+    std::vector<Literal> trail;
+    std::vector<size_t> trail_limits;
+    size_t propagated = 0;
+    size_t conflicts = 0;
+    bool unsatisfiable = false;
+    std::vector<bool> model;
+};
+
+// encodeTseitin adds clauses that define a literal for every node reachable from root
+// and returns the literal of root. symbol_literals gives the literal of every symbol id,
+// true_literal is a variable the caller forced true. Shared nodes of the DAG get one
+// literal, so the clauses grow linearly with the arena.
+Literal encodeTseitin(SatSolver &solver, const Ast &ast, uint32_t root,
+                      const std::vector<Literal> &symbol_literals, Literal true_literal) {
+    std::vector<bool> reachable(root + 1);
+    std::vector<uint32_t> stack{root};
+    reachable[root] = true;
+    while (!stack.empty()) {
+        const auto &node = ast[stack.back()];
+        stack.pop_back();
+        if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+            continue;
+        }
+        for (uint32_t child:{node.left, node.right}) {
+            if (child != NO_NODE && !reachable[child]) {
+                reachable[child] = true;
+                stack.push_back(child);
+            }
+        }
+    }
+
+    // children have smaller indices than their parents, so one ascending pass suffices
+    std::vector<Literal> literals(root + 1);
+    for (uint32_t index = 0; index <= root; ++index) {
+        if (!reachable[index]) {
+            continue;
+        }
+        const auto &node = ast[index];
+        if (node.type == TokenType::SYMBOL) {
+            literals[index] = symbol_literals[node.symbol];
+            continue;
+        }
+        if (node.type == TokenType::CONSTANT) {
+            literals[index] = node.symbol ? true_literal : negate(true_literal);
+            continue;
+        }
+        if (node.type == TokenType::NOT_OPERATOR) {
+            literals[index] = negate(literals[node.left]);
+            continue;
+        }
+        Literal x = makeLiteral(solver.NewVariable());
+        Literal a = literals[node.left];
+        Literal b = literals[node.right];
+        switch (node.type) {
+            case TokenType::AND_OPERATOR:
+                solver.AddClause({negate(x), a});
+                solver.AddClause({negate(x), b});
+                solver.AddClause({x, negate(a), negate(b)});
+                break;
+            case TokenType::OR_OPERATOR:
+                solver.AddClause({x, negate(a)});
+                solver.AddClause({x, negate(b)});
+                solver.AddClause({negate(x), a, b});
+                break;
+            case TokenType::IMPLICATION:
+                solver.AddClause({x, a});
+                solver.AddClause({x, negate(b)});
+                solver.AddClause({negate(x), negate(a), b});
+                break;
+            case TokenType::EQUALITY:
+                solver.AddClause({negate(x), negate(a), b});
+                solver.AddClause({negate(x), a, negate(b)});
+                solver.AddClause({x, a, b});
+                solver.AddClause({x, negate(a), negate(b)});
+                break;
+            default:
+                throw std::invalid_argument("unexpected node in formula");
+        }
+        literals[index] = x;
+    }
+    return literals[root];
+}
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_SAT_SOLVER_H
@@ -5,10 +5,12 @@
 #ifndef INC_1LAB_SEMANTIC_ANALYZER_H
 #define INC_1LAB_SEMANTIC_ANALYZER_H
 
+#include <bit>
 #include <memory>
 #include <utility>
 #include <vector>
 #include "expression.h"
+#include "ast.h"
 #include <ranges>
 #include <algorithm>
 #include <iterator>
@@ -16,47 +18,127 @@
 #include <functional>
 #include <set>
 #include <deque>
+#include <string_view>
+#include <unordered_set>
+#include "row_patterns.h"
+#include "bytecode.h"
+#include "bit_vector.h"
+#include "bdd.h"
+#include "sat_solver.h"
+#include "minimizer.h"
 
-template<std::ranges::range R>
-auto to_vector(R &&r) {
-    auto r_common = r | std::views::common;
-    return std::vector(r_common.begin(), r_common.end());
+enum class Engine {
+    // INTERPRETER walks the tree once per row via interpret().
+    INTERPRETER,
+    // BIT_PARALLEL lowers the tree to a bytecode program and runs it on blocks of rows.
+    BIT_PARALLEL,
+    // BDD builds a reduced ordered BDD and expands the truth table from it.
+    BDD,
+};
+
+struct CalculateOptions {
+    Engine engine = Engine::BIT_PARALLEL;
+    // kernel forces the word kernels of the bit-parallel engine, AUTO picks the widest.
+    Kernel kernel = Kernel::AUTO;
+    // threads splits the rows of the bit-parallel engine across a thread pool,
+    // 0 uses every hardware thread.
+    size_t threads = 1;
+};
+
+// spreadRows expands a truth table over some of the columns of a wider one: bit k of a
+// row index of table is bit columns[k] of the wide row index, the other columns of the
+// wide table do not change the result. The rows of a word share the columns from the
+// seventh on, so only the six low ones are looked up per row.
+BitVector spreadRows(const BitVector &table, const std::vector<uint32_t> &columns, uint32_t variables) {
+    size_t rows = size_t(1) << variables;
+    std::vector<uint64_t> words(wordsForRows(rows));
+    size_t low_index[ROWS_PER_WORD] = {};
+    for (size_t bit = 0; bit < ROWS_PER_WORD; ++bit) {
+        for (uint32_t k = 0; k < columns.size(); ++k) {
+            if (columns[k] < LOW_VARIABLES) {
+                low_index[bit] |= ((bit >> columns[k]) & 1) << k;
+            }
+        }
+    }
+    for (size_t w = 0; w < words.size(); ++w) {
+        size_t high_index = 0;
+        for (uint32_t k = 0; k < columns.size(); ++k) {
+            if (columns[k] >= LOW_VARIABLES) {
+                high_index |= ((w >> (columns[k] - LOW_VARIABLES)) & 1) << k;
+            }
+        }
+        uint64_t word = 0;
+        for (size_t bit = 0; bit < std::min(ROWS_PER_WORD, rows); ++bit) {
+            word |= uint64_t(table[high_index | low_index[bit]]) << bit;
+        }
+        words[w] = word;
+    }
+    return {std::move(words), rows};
 }
 
+// REPEATED_ELEMENT_ERROR starts the only PDNF error that names symbols.
+constexpr std::string_view REPEATED_ELEMENT_ERROR = "got repeated element: ";
 
 class SemanticAnalyzer {
 public:
     SemanticAnalyzer(
-            std::shared_ptr<BooleanExpression> root,
+            const Ast &ast,
             const std::shared_ptr<SymbolTable> &symbol_table
-    ) : root(std::move(root)), symbol_table(symbol_table) {}
+    ) : ast(ast), symbol_table(symbol_table) {}
+
+    // PdnfError is why a formula is not in PDNF, at the occurrence at fault. The
+    // occurrence index only depends on the shape of the formula, so a PdnfError stays
+    // valid for every formula with the same canonicalKey, see CompileCache.
+    struct PdnfError {
+        ErrorCode code;
+        uint32_t occurrence;
+        std::string message;
+
+        Diagnostic At(const Ast &ast) const {
+            return {code, ast.Span(occurrence), message};
+        }
+    };
+
+    // FindPdnfError returns the first reason the formula is not in PDNF, if any. It does
+    // not throw.
+    std::optional<PdnfError> FindPdnfError() {
+        error.reset();
+        checkIsPDNF();
+        return std::move(error);
+    }
+
+    std::optional<Diagnostic> CheckPDNF() {
+        if (auto pdnf_error = FindPdnfError()) {
+            return pdnf_error->At(ast);
+        }
+        return {};
+    }
 
     std::optional<std::string> IsPDNF() {
-        try {
-            auto parsed_dnfs = parseFormula();
-            auto sorted_parsed_dnfs = to_vector(parsed_dnfs | std::ranges::views::transform([&](auto dnf) {
-                std::ranges::sort(dnf.begin(), dnf.end(), [&](auto lhs, auto rhs) {
-                    return lhs.first < rhs.first;
-                });
-                return dnf;
-            }));
-            if (hasDuplicates(sorted_parsed_dnfs)) {
-                throw std::invalid_argument("got equal elementary conjunction");
-            }
-            if (parsed_dnfs.size() > std::pow(2, parsed_dnfs[0].size())) {
-                throw std::invalid_argument("got to many conjunction");
-            }
-            checkForEqualVars(sorted_parsed_dnfs);
-        } catch (const std::exception &ex) {
-            return std::optional(ex.what());
+        if (auto pdnf_error = FindPdnfError()) {
+            return std::move(pdnf_error->message);
         }
         return {};
     }
 
+    // FormulaResult is a truth table with the result column packed one bit per row. The
+    // input columns are not stored: the symbols bound by let come first and hold
+    // bound_values in every row, the free symbols of row i take the bits of i.
     struct FormulaResult {
         std::vector<std::string> symbols;
-        std::deque<bool> results;
-        std::vector<std::deque<bool>> matrix_values;
+        std::deque<bool> bound_values;
+        BitVector results;
+
+        size_t Rows() const {
+            return results.Size();
+        }
+
+        // Row regenerates the symbol values of row i.
+        std::deque<bool> Row(size_t i) const {
+            std::deque<bool> row;
+            fillRow(row, i, symbols.size() - bound_values.size(), bound_values);
+            return row;
+        }
     };
 
     struct SharedComparator {
@@ -67,7 +149,66 @@ public:
         }
     };
 
-    FormulaResult CalculateFormula() const {
+    FormulaResult CalculateFormula(const CalculateOptions &options = {}) const {
+        if (options.engine == Engine::INTERPRETER) {
+            FormulaResult result;
+            for (const auto&[token, constant]:symbol_table->getTokenToConstant()) {
+                result.bound_values.push_back(constant.getValue());
+            }
+            StreamFormula([&](const std::vector<std::string> &symbols) {
+                result.symbols = symbols;
+            }, [&](const std::deque<bool> &, bool value) {
+                result.results.PushBack(value);
+            }, options);
+            return result;
+        }
+        auto result = ResultColumns();
+        if (options.engine == Engine::BDD) {
+            result.results = bddTruthTable();
+            return result;
+        }
+        // free symbols the simplified formula lost do not take part in the evaluation, the
+        // rows are spread over them afterwards
+        auto free_symbols = FreeSymbols();
+        auto used = usedColumns(free_symbols);
+        std::vector<uint32_t> variables;
+        for (uint32_t column:used) {
+            variables.push_back(free_symbols[column]);
+        }
+        auto program = CompileProgram(variables);
+        result.results = BitVector(evaluateProgram(program, selectKernels(options.kernel), options.threads),
+                                   size_t(1) << program.variables);
+        if (used.size() < free_symbols.size()) {
+            result.results = spreadRows(result.results, used, free_symbols.size());
+        }
+        return result;
+    }
+
+    // ResultColumns returns the columns of the bit-parallel truth table, without results.
+    FormulaResult ResultColumns() const {
+        FormulaResult result;
+        for (const auto&[token, constant]:symbol_table->getTokenToConstant()) {
+            result.bound_values.push_back(constant.getValue());
+        }
+        result.symbols = getSymbols();
+        return result;
+    }
+
+    // FreeSymbols returns the ids of the symbols not bound by let in table column order.
+    std::vector<uint32_t> FreeSymbols() const {
+        return getFreeSymbols(symbol_table->getTokenToConstant());
+    }
+
+    using SymbolsCallback = std::function<void(const std::vector<std::string> &symbols)>;
+    // RowCallback receives the values of the symbols in one row and its result. The row is
+    // reused between calls, so copy it to keep it.
+    using RowCallback = std::function<void(const std::deque<bool> &row, bool result)>;
+
+    // StreamFormula emits the truth table row by row as it is computed instead of
+    // materializing it: first the symbols, then every row in order. The bit-parallel
+    // engine keeps only a window of blocks in memory.
+    void StreamFormula(const SymbolsCallback &on_symbols, const RowCallback &on_row,
+                       const CalculateOptions &options = {}) const {
         auto token_to_const = symbol_table->getTokenToConstant();
         std::vector<std::string> symbols;
         std::deque<bool> initial_values;
@@ -76,192 +217,517 @@ public:
             initial_values.push_back(constant.getValue());
         }
 
-        std::vector<std::shared_ptr<Terminal>> symbols_without_values;
-        getSymbolsWithoutValuesAndSetValues(symbols_without_values, root, token_to_const);
-        std::set<std::shared_ptr<Terminal>, SharedComparator> symbols_without_values_unique(
-                symbols_without_values.begin(),
-                symbols_without_values.end());
-        for (const auto &term:symbols_without_values_unique) {
-            symbols.push_back(term->string());
+        if (options.engine == Engine::INTERPRETER) {
+            auto root = ast.ToExpression(ast.Root());
+            std::vector<std::shared_ptr<Terminal>> symbols_without_values;
+            getSymbolsWithoutValuesAndSetValues(symbols_without_values, root, token_to_const);
+            std::set<std::shared_ptr<Terminal>, SharedComparator> symbols_without_values_unique(
+                    symbols_without_values.begin(),
+                    symbols_without_values.end());
+            for (const auto &term:symbols_without_values_unique) {
+                symbols.push_back(term->string());
+            }
+            on_symbols(symbols);
+            getRowsAndResult(root, symbols_without_values, symbols_without_values_unique, initial_values, on_row);
+            return;
         }
 
-        auto[matrix, results]=getRowsAndResult(symbols_without_values, symbols_without_values_unique, initial_values);
-        return {
-                .symbols=symbols,
-                .results=results,
-                .matrix_values=matrix
-        };
+        on_symbols(getSymbols());
+        if (options.engine == Engine::BDD) {
+            auto variables = FreeSymbols().size();
+            auto results = bddTruthTable();
+            std::deque<bool> row;
+            for (size_t i = 0; i < results.Size(); ++i) {
+                fillRow(row, i, variables, initial_values);
+                on_row(row, results[i]);
+            }
+            return;
+        }
+        getRowsAndResultBitParallel(CompileProgram(), initial_values, selectKernels(options.kernel), options.threads,
+                                    on_row);
+    }
+
+    // StreamRows calls on_row with the index of every row whose result is value, in row
+    // order. The rows come from the blocks of the bit-parallel engine, so memory stays
+    // bounded and no row walks the tree.
+    void StreamRows(bool value, const std::function<void(size_t row)> &on_row,
+                    const CalculateOptions &options = {}) const {
+        streamProgram(CompileProgram(), selectKernels(options.kernel), options.threads,
+                      [&](size_t first_row, const uint64_t *words, size_t rows) {
+                          for (size_t w = 0; w < wordsForRows(rows); ++w) {
+                              uint64_t word = value ? words[w] : ~words[w];
+                              size_t word_rows = std::min(ROWS_PER_WORD, rows - w * ROWS_PER_WORD);
+                              if (word_rows < ROWS_PER_WORD) {
+                                  word &= (uint64_t(1) << word_rows) - 1;
+                              }
+                              for (; word != 0; word &= word - 1) {
+                                  on_row(first_row + w * ROWS_PER_WORD + std::countr_zero(word));
+                              }
+                          }
+                      });
+    }
+
+    // BuildBdd builds the formula in manager, the free symbols named variables[j] are
+    // variable j and the symbols bound by let are constants. Every free symbol of the
+    // formula must be in variables.
+    BddRef BuildBdd(BddManager &manager, const std::vector<std::string> &variables) const {
+        auto token_to_const = symbol_table->getTokenToConstant();
+        std::vector<BddRef> symbol_bdds(ast.Symbols().size());
+        for (uint32_t id = 0; id < symbol_bdds.size(); ++id) {
+            if (auto value = getBoundValue(id, token_to_const)) {
+                symbol_bdds[id] = value.value() ? BDD_TRUE : BDD_FALSE;
+                continue;
+            }
+            auto it = std::ranges::find(variables, ast.Symbol(id));
+            if (it == variables.end()) {
+                throw std::invalid_argument("no bdd variable for symbol " + ast.Symbol(id));
+            }
+            symbol_bdds[id] = manager.Var(it - variables.begin());
+        }
+        return buildBdd(manager, ast, ast.EvaluationRoot(), symbol_bdds);
+    }
+
+    // BddSummary answers the questions that need no truth table from the BDD of the
+    // formula, over its free symbols.
+    struct BddSummary {
+        std::vector<std::string> variables;
+        size_t nodes = 0;
+        uint64_t models = 0;
+        bool tautology = false;
+        // witness assigns variables a satisfying row, it is empty if there is none.
+        std::optional<std::vector<bool>> witness;
+    };
+
+    BddSummary AnalyzeBdd() const {
+        BddSummary summary;
+        summary.variables = FreeSymbolNames();
+        BddManager manager(summary.variables.size());
+        BddRef f = BuildBdd(manager, summary.variables);
+        summary.nodes = manager.Size();
+        summary.models = manager.ModelCount(f);
+        summary.tautology = f == BDD_TRUE;
+        summary.witness = manager.AnyModel(f);
+        return summary;
+    }
+
+    // SatResult is the outcome of a SAT query over the free symbols of the formula.
+    struct SatResult {
+        std::vector<std::string> variables;
+        // witness assigns variables a row with the requested result, it is empty if there
+        // is none.
+        std::optional<std::vector<bool>> witness;
+    };
+
+    // FindRow asks the SAT solver for a row whose result is value: true checks
+    // satisfiability, false looks for a counterexample to a tautology. The formula is
+    // Tseitin-encoded, so no rows are enumerated.
+    SatResult FindRow(bool value) const {
+        auto token_to_const = symbol_table->getTokenToConstant();
+        SatResult result;
+        SatSolver solver;
+        std::vector<Literal> symbol_literals(ast.Symbols().size());
+        for (uint32_t id:getFreeSymbols(token_to_const)) {
+            result.variables.push_back(ast.Symbol(id));
+            symbol_literals[id] = makeLiteral(solver.NewVariable());
+        }
+        Literal true_literal = makeLiteral(solver.NewVariable());
+        solver.AddClause({true_literal});
+        for (uint32_t id = 0; id < symbol_literals.size(); ++id) {
+            if (auto bound = getBoundValue(id, token_to_const)) {
+                symbol_literals[id] = bound.value() ? true_literal : negate(true_literal);
+            }
+        }
+        Literal root = encodeTseitin(solver, ast, ast.EvaluationRoot(), symbol_literals, true_literal);
+        solver.AddClause({value ? root : negate(root)});
+        if (solver.Solve()) {
+            result.witness.emplace(solver.Model().begin(), solver.Model().begin() + result.variables.size());
+        }
+        return result;
+    }
+
+    // Minimize returns a minimal or near-minimal DNF of the formula over its free symbols:
+    // Quine-McCluskey on the truth table up to QM_MAX_VARIABLES variables, and the
+    // Espresso-style heuristic on the BDD beyond.
+    Cover Minimize() const {
+        Cover cover;
+        cover.variables = FreeSymbolNames();
+        uint32_t variables = cover.variables.size();
+        if (variables <= QM_MAX_VARIABLES) {
+            cover.cubes = minimizeTable(CalculateFormula().results, variables);
+        } else {
+            BddManager manager(variables);
+            cover.cubes = minimizeBdd(manager, BuildBdd(manager, cover.variables));
+        }
+        return cover;
+    }
+
+    // FreeSymbolNames returns the names of the symbols not bound by let in column order.
+    std::vector<std::string> FreeSymbolNames() const {
+        std::vector<std::string> names;
+        for (uint32_t id:FreeSymbols()) {
+            names.push_back(ast.Symbol(id));
+        }
+        return names;
     }
 
-    std::pair<std::vector<std::deque<bool>>, std::deque<bool>>
-    getRowsAndResult(const std::vector<std::shared_ptr<Terminal>> &symbols_without_values,
+    void
+    getRowsAndResult(const std::shared_ptr<BooleanExpression> &root,
+                     const std::vector<std::shared_ptr<Terminal>> &symbols_without_values,
                      const std::set<std::shared_ptr<Terminal>, SharedComparator> &symbols_without_values_unique,
-                     const std::deque<bool> &initial_values
+                     const std::deque<bool> &initial_values,
+                     const RowCallback &on_row
     ) const {
-        size_t amount_of_data_vectors = std::pow(2, symbols_without_values_unique.size());
-        std::vector<std::deque<bool>> rows_of_symbol_values;
-        std::deque<bool> results;
+        auto occurrences = groupOccurrences(symbols_without_values, symbols_without_values_unique);
+        size_t amount_of_data_vectors = size_t(1) << symbols_without_values_unique.size();
+        std::deque<bool> row;
         for (size_t i = 0; i < amount_of_data_vectors; ++i) {
-            std::deque<bool> row(initial_values.begin(), initial_values.end());
-            auto it = symbols_without_values_unique.begin();
-            for (size_t j = 0; j < symbols_without_values_unique.size(); ++j) {
-                bool value = ((i & (int) std::pow(2, j)) > 0);
-                row.push_back(value);
-                for (auto &s:symbols_without_values) {
-                    if (s->string() == it->get()->string()) {
-                        s->SetValue(value);
-                    }
+            for (size_t j = 0; j < occurrences.size(); ++j) {
+                bool value = (i >> j) & 1;
+                for (auto &s:occurrences[j]) {
+                    s->SetValue(value);
                 }
-                ++it;
             }
             bool result = root->interpret();
-            results.push_back(result);
-            rows_of_symbol_values.push_back(std::move(row));
+            fillRow(row, i, occurrences.size(), initial_values);
+            on_row(row, result);
         }
-        return {rows_of_symbol_values, results};
     }
 
+    // getRowsAndResultBitParallel produces the same rows as getRowsAndResult. The formula is
+    // lowered once to a Program, and the virtual machine evaluates it one block of
+    // BLOCK_WORDS words at a time with the given word kernels, on threads threads.
+    void
+    getRowsAndResultBitParallel(const Program &program,
+                                const std::deque<bool> &initial_values,
+                                const WordKernels &kernels,
+                                size_t threads,
+                                const RowCallback &on_row
+    ) const {
+        std::deque<bool> row;
+        streamProgram(program, kernels, threads, [&](size_t first_row, const uint64_t *words, size_t rows) {
+            for (size_t bit = 0; bit < rows; ++bit) {
+                fillRow(row, first_row + bit, program.variables, initial_values);
+                on_row(row, (words[bit / ROWS_PER_WORD] >> (bit % ROWS_PER_WORD)) & 1);
+            }
+        });
+    }
+
+    // CompileProgram lowers the formula with the free variables numbered in table column
+    // order and the symbols bound by let read from the constant registers.
+    Program CompileProgram() const {
+        return CompileProgram(FreeSymbols());
+    }
+
+    // CompileProgram lowers the formula over the free symbols in free_symbols only, variable
+    // j is free_symbols[j]. The evaluation formula must not use other free symbols.
+    Program CompileProgram(const std::vector<uint32_t> &free_symbols) const {
+        auto token_to_const = symbol_table->getTokenToConstant();
+        std::vector<uint32_t> symbol_registers(ast.Symbols().size());
+        uint32_t false_register = free_symbols.size();
+        uint32_t true_register = false_register + 1;
+        for (uint32_t id = 0; id < symbol_registers.size(); ++id) {
+            if (auto value = getBoundValue(id, token_to_const)) {
+                symbol_registers[id] = value.value() ? true_register : false_register;
+            }
+        }
+        for (uint32_t column = 0; column < free_symbols.size(); ++column) {
+            symbol_registers[free_symbols[column]] = column;
+        }
+        return BytecodeCompiler(ast, symbol_registers, free_symbols.size()).Compile(ast.EvaluationRoot());
+    }
+
+    // getSymbolsWithoutValuesAndSetValues sets the value of every Terminal bound by let and
+    // collects the others, right subtrees first. The tree is walked with an explicit stack.
     void
     getSymbolsWithoutValuesAndSetValues(
             std::vector<std::shared_ptr<Terminal>> &terminals,
             const std::shared_ptr<BooleanExpression> &expression,
             const std::unordered_map<Token, Constant> &term_to_constant) const {
-        TokenType root_token_type = expression->getTokenType();
-        if (isBinaryOperation(root_token_type)) {
-            auto bin_op = std::dynamic_pointer_cast<NonTerminal>(expression);
-            auto right = bin_op->GetRight();
-            getSymbolsWithoutValuesAndSetValues(terminals, right, term_to_constant);
-            auto left = bin_op->GetLeft();
-            getSymbolsWithoutValuesAndSetValues(terminals, left, term_to_constant);
-        } else if (root_token_type == TokenType::NOT_OPERATOR) {
-            auto not_op = std::dynamic_pointer_cast<NotOperation>(expression);
-            auto child = not_op->GetChild();
-            getSymbolsWithoutValuesAndSetValues(terminals, child, term_to_constant);
-        } else if (root_token_type == TokenType::SYMBOL) {
-            auto symbol = std::dynamic_pointer_cast<Terminal>(expression);
-            bool found = false;
-            for (auto &[token, constant]:term_to_constant) {
-                if (token.value == symbol->string()) {
-                    found = true;
-                    symbol->SetValue(constant.getValue());
+        std::vector<std::shared_ptr<BooleanExpression>> stack{expression};
+        while (!stack.empty()) {
+            auto current = std::move(stack.back());
+            stack.pop_back();
+            TokenType root_token_type = current->getTokenType();
+            if (isBinaryOperation(root_token_type)) {
+                auto bin_op = std::dynamic_pointer_cast<NonTerminal>(current);
+                stack.push_back(bin_op->GetLeft());
+                stack.push_back(bin_op->GetRight());
+            } else if (root_token_type == TokenType::NOT_OPERATOR) {
+                auto not_op = std::dynamic_pointer_cast<NotOperation>(current);
+                stack.push_back(not_op->GetChild());
+            } else if (root_token_type == TokenType::SYMBOL) {
+                auto symbol = std::dynamic_pointer_cast<Terminal>(current);
+                bool found = false;
+                for (auto &[token, constant]:term_to_constant) {
+                    if (token.value == symbol->string()) {
+                        found = true;
+                        symbol->SetValue(constant.getValue());
+                    }
+                }
+                if (!found) {
+                    terminals.push_back(symbol);
                 }
-            }
-            if (!found) {
-                terminals.push_back(symbol);
             }
         }
     }
 
 private:
 
-    std::vector<std::vector<std::pair<std::string, bool>>> parseFormula() {
-        splitDNFs(root);
-        std::vector<std::vector<std::pair<std::string, bool>>> parsed_dnfs;
-        parsed_dnfs.resize(dnfs.size());
-        size_t counter = 0;
-        for (const auto &dnf:dnfs) {
-            checkIsDNF(dnf, parsed_dnfs[counter]);
-            assertNoRepeatedVars(parsed_dnfs[counter]);
-            ++counter;
-        }
-        return parsed_dnfs;
+    BitVector bddTruthTable() const {
+        auto variables = FreeSymbolNames();
+        BddManager manager(variables.size());
+        return manager.TruthTable(BuildBdd(manager, variables));
     }
 
-    void checkForEqualVars(const std::vector<std::vector<std::pair<std::string, bool>>> &parsed_dnfs) const {
-        for (const auto &dnf:parsed_dnfs) {
-            if (dnf.size() != parsed_dnfs[0].size()) {
-                throw std::invalid_argument("got not equal vars in conjunctions");
+    // usedColumns returns the columns of free_symbols that occur in the evaluation formula.
+    std::vector<uint32_t> usedColumns(const std::vector<uint32_t> &free_symbols) const {
+        std::vector<bool> occurs(ast.Symbols().size());
+        std::vector<bool> visited(ast.Size());
+        std::vector<uint32_t> stack{ast.EvaluationRoot()};
+        visited[stack.back()] = true;
+        while (!stack.empty()) {
+            const auto &node = ast[stack.back()];
+            stack.pop_back();
+            if (node.type == TokenType::SYMBOL) {
+                occurs[node.symbol] = true;
+            }
+            if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+                continue;
             }
-            for (size_t i = 1; i < dnf.size(); ++i) {
-                if (dnf[i].first != parsed_dnfs[0][i].first) {
-                    throw std::invalid_argument("got not equal vars in conjunctions");
+            for (uint32_t child:{node.left, node.right}) {
+                if (child != NO_NODE && !visited[child]) {
+                    visited[child] = true;
+                    stack.push_back(child);
                 }
             }
         }
+        std::vector<uint32_t> used;
+        for (uint32_t column = 0; column < free_symbols.size(); ++column) {
+            if (occurs[free_symbols[column]]) {
+                used.push_back(column);
+            }
+        }
+        return used;
     }
 
-    template<class T>
-    bool hasDuplicates(std::vector<T> &v) {
-        std::sort(v.begin(), v.end());
+    // getSymbols returns the table columns of the bit-parallel engine: the symbols bound by
+    // let, then the free symbols ordered by name.
+    std::vector<std::string> getSymbols() const {
+        auto token_to_const = symbol_table->getTokenToConstant();
+        std::vector<std::string> symbols;
+        for (const auto&[token, constant]:token_to_const) {
+            symbols.push_back(token.value);
+        }
+        for (uint32_t id:getFreeSymbols(token_to_const)) {
+            symbols.push_back(ast.Symbol(id));
+        }
+        return symbols;
+    }
 
-        return std::adjacent_find(v.begin(), v.end()) != v.end();
+    std::optional<bool> getBoundValue(uint32_t symbol_id, const std::unordered_map<Token, Constant> &term_to_constant) const {
+        std::optional<bool> value;
+        for (const auto &[token, constant]:term_to_constant) {
+            if (token.value == ast.Symbol(symbol_id)) {
+                value = constant.getValue();
+            }
+        }
+        return value;
     }
 
-    template<typename It, typename BackIt>
-    void findDuplicates(It begin, It end, BackIt back_inserter) {
-        std::sort(begin, end);
-        std::set<typename std::iterator_traits<It>::value_type> unique(begin, end);
-        std::set_difference(begin, end, unique.begin(), unique.end(), back_inserter);
+    // getFreeSymbols returns the ids of the symbols not bound by let, ordered by name.
+    std::vector<uint32_t> getFreeSymbols(const std::unordered_map<Token, Constant> &term_to_constant) const {
+        std::vector<uint32_t> free_symbols;
+        for (uint32_t id = 0; id < ast.Symbols().size(); ++id) {
+            if (!getBoundValue(id, term_to_constant)) {
+                free_symbols.push_back(id);
+            }
+        }
+        std::ranges::sort(free_symbols, [&](uint32_t lhs, uint32_t rhs) {
+            return ast.Symbol(lhs) < ast.Symbol(rhs);
+        });
+        return free_symbols;
     }
 
-    void assertNoRepeatedVars(const std::vector<std::pair<std::string, bool>> &parsed_dnf) {
-        auto transformed = to_vector(parsed_dnf | std::ranges::views::transform([&](auto p) {
-            return p.first;
-        }));
-        std::vector<std::string> diff;
-        findDuplicates(transformed.begin(), transformed.end(), std::back_inserter(diff));
-        if (diff.begin() == diff.end()) {
-            return;
+    // groupOccurrences collects every Terminal node of each unique variable, so that the
+    // row loops can assign values without comparing symbol strings.
+    static std::vector<std::vector<std::shared_ptr<Terminal>>>
+    groupOccurrences(const std::vector<std::shared_ptr<Terminal>> &symbols_without_values,
+                     const std::set<std::shared_ptr<Terminal>, SharedComparator> &symbols_without_values_unique) {
+        std::vector<std::vector<std::shared_ptr<Terminal>>> occurrences;
+        for (const auto &unique:symbols_without_values_unique) {
+            auto &group = occurrences.emplace_back();
+            for (const auto &s:symbols_without_values) {
+                if (s->string() == unique->string()) {
+                    group.push_back(s);
+                }
+            }
         }
-        std::stringstream ss;
-        ss << "got repeated element: ";
-        std::move(diff.begin(), diff.end(), std::ostream_iterator<std::string>(ss));
-        throw std::invalid_argument(ss.str());
-    }
-
-    void checkIsDNF(const std::shared_ptr<BooleanExpression> &node, std::vector<std::pair<std::string, bool>> &parsed_dnf) {
-        auto and_operation = std::dynamic_pointer_cast<AndOperation>(node);
-        checkNodeIsDNF(and_operation->GetLeft(), parsed_dnf);
-        checkNodeIsDNF(and_operation->GetRight(), parsed_dnf);
-    }
-
-    void checkNodeIsDNF(const std::shared_ptr<BooleanExpression> &node,
-                        std::vector<std::pair<std::string, bool>> &parsed_dnf) {
-        TokenType right_token_type = node->getTokenType();
-        if (right_token_type == TokenType::SYMBOL) {
-            parsed_dnf.emplace_back(node->string(), true);
-        } else if (right_token_type == TokenType::AND_OPERATOR) {
-            checkIsDNF(node, parsed_dnf);
-        } else if (right_token_type == TokenType::NOT_OPERATOR) {
-            auto not_operation = std::dynamic_pointer_cast<NotOperation>(node);
-            if (not_operation->GetChild()->getTokenType() != TokenType::SYMBOL) {
-                throw std::invalid_argument("expected a type here");
+        return occurrences;
+    }
+
+    static void fillRow(std::deque<bool> &row, size_t row_index, size_t variables,
+                        const std::deque<bool> &initial_values) {
+        row.assign(initial_values.begin(), initial_values.end());
+        for (size_t j = 0; j < variables; ++j) {
+            row.push_back((row_index >> j) & 1);
+        }
+    }
+
+    // checkIsPDNF encodes every elementary conjunction as a pair of bitsets over the
+    // interned symbol ids: mask holds the symbols it mentions, polarity the ones that are
+    // not negated. Equal conjunctions are found through a hash set over those bitsets, so
+    // the whole check is linear in the number of literals. The formula is walked by its
+    // occurrences, so an error points at the place of the input at fault even when the
+    // node is shared. Like the helpers below it returns false on the first error, which is
+    // then in error.
+    bool checkIsPDNF() {
+        dnfs.clear();
+        if (!splitDNFs(ast.RootOccurrence())) {
+            return false;
+        }
+        size_t words = (ast.Symbols().size() + 63) / 64;
+        std::vector<uint64_t> masks(dnfs.size() * words);
+        std::vector<uint64_t> polarities(dnfs.size() * words);
+        std::vector<size_t> literal_counts;
+        literal_counts.reserve(dnfs.size());
+        std::vector<std::pair<uint32_t, bool>> literals;
+        for (size_t k = 0; k < dnfs.size(); ++k) {
+            literals.clear();
+            if (!checkIsDNF(dnfs[k], literals)) {
+                return false;
+            }
+            uint64_t *mask = &masks[k * words];
+            uint64_t *polarity = &polarities[k * words];
+            for (auto[id, positive]:literals) {
+                uint64_t bit = uint64_t(1) << (id % 64);
+                if (mask[id / 64] & bit) {
+                    return failRepeatedVars(dnfs[k], literals);
+                }
+                mask[id / 64] |= bit;
+                if (positive) {
+                    polarity[id / 64] |= bit;
+                }
+            }
+            literal_counts.push_back(literals.size());
+        }
+
+        auto same_mask = [&](size_t lhs, size_t rhs) {
+            return std::equal(&masks[lhs * words], &masks[(lhs + 1) * words], &masks[rhs * words]);
+        };
+        auto hash = [&](size_t k) {
+            size_t h = 0;
+            for (size_t w = k * words; w < (k + 1) * words; ++w) {
+                h = h * 31 + std::hash<uint64_t>()(masks[w]);
+                h = h * 31 + std::hash<uint64_t>()(polarities[w]);
+            }
+            return h;
+        };
+        auto equal = [&](size_t lhs, size_t rhs) {
+            return same_mask(lhs, rhs) &&
+                   std::equal(&polarities[lhs * words], &polarities[(lhs + 1) * words], &polarities[rhs * words]);
+        };
+        std::unordered_set<size_t, decltype(hash), decltype(equal)> seen(dnfs.size(), hash, equal);
+        for (size_t k = 0; k < dnfs.size(); ++k) {
+            if (!seen.insert(k).second) {
+                return fail(ErrorCode::REPEATED_CONJUNCTION, dnfs[k], "got equal elementary conjunction");
             }
-            parsed_dnf.emplace_back(not_operation->GetChild()->string(), false);
-        } else {
-            throw std::invalid_argument("unexpected token");
         }
+        if (literal_counts[0] < 64 && dnfs.size() > (uint64_t(1) << literal_counts[0])) {
+            return fail(ErrorCode::TOO_MANY_CONJUNCTIONS, ast.RootOccurrence(), "got to many conjunction");
+        }
+        for (size_t k = 1; k < dnfs.size(); ++k) {
+            if (literal_counts[k] != literal_counts[0] || !same_mask(k, 0)) {
+                return fail(ErrorCode::DIFFERENT_VARIABLES, dnfs[k], "got not equal vars in conjunctions");
+            }
+        }
+        return true;
     }
 
-    void splitDNFs(const std::shared_ptr<BooleanExpression> &node) {
-        if (node->getTokenType() == TokenType::AND_OPERATOR) {
-            dnfs.push_back(node);
-            return;
+    // failRepeatedVars reports every repeated symbol of a conjunction, once per repetition.
+    bool failRepeatedVars(uint32_t occurrence, const std::vector<std::pair<uint32_t, bool>> &literals) {
+        std::vector<std::string> names;
+        for (auto[id, positive]:literals) {
+            names.push_back(ast.Symbol(id));
         }
-        if (node->getTokenType() != TokenType::OR_OPERATOR) {
-            throw std::invalid_argument("expected or operator");
+        std::ranges::sort(names);
+        std::stringstream ss;
+        ss << REPEATED_ELEMENT_ERROR;
+        for (size_t i = 1; i < names.size(); ++i) {
+            if (names[i] == names[i - 1]) {
+                ss << names[i];
+            }
         }
-        auto or_operation = std::dynamic_pointer_cast<OrOperation>(node);
-        auto left = or_operation->GetLeft();
-        splitDNF(left);
-        auto right = or_operation->GetRight();
-        splitDNF(right);
+        return fail(ErrorCode::REPEATED_VARIABLE, occurrence, ss.str());
     }
 
-    void splitDNF(const std::shared_ptr<BooleanExpression> &node) {
-        if (node->getTokenType() == TokenType::OR_OPERATOR) {
-            splitDNFs(node);
-        } else if (node->getTokenType() == TokenType::AND_OPERATOR) {
-            dnfs.push_back(node);
-        } else {
-            std::stringstream ss;
-            ss << "unexpected operator in PDNF: " << node->getTokenType();
-            throw std::invalid_argument(ss.str());
+    // checkIsDNF collects the literals of the conjunction at occurrence from left to right.
+    bool checkIsDNF(uint32_t occurrence, std::vector<std::pair<uint32_t, bool>> &parsed_dnf) {
+        std::vector<uint32_t> stack{ast.RightOccurrence(occurrence), ast.LeftOccurrence(occurrence)};
+        while (!stack.empty()) {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            const auto &node = ast[ast.NodeOf(current)];
+            switch (node.type) {
+                case TokenType::SYMBOL:
+                    parsed_dnf.emplace_back(node.symbol, true);
+                    break;
+                case TokenType::AND_OPERATOR:
+                    stack.push_back(ast.RightOccurrence(current));
+                    stack.push_back(ast.LeftOccurrence(current));
+                    break;
+                case TokenType::NOT_OPERATOR: {
+                    const auto &child = ast[node.left];
+                    if (child.type != TokenType::SYMBOL) {
+                        return fail(ErrorCode::NOT_A_LITERAL, current, "expected a type here");
+                    }
+                    parsed_dnf.emplace_back(child.symbol, false);
+                    break;
+                }
+                default:
+                    return fail(ErrorCode::NOT_A_LITERAL, current, "unexpected token");
+            }
+        }
+        return true;
+    }
+
+    // splitDNFs collects the conjunctions joined by the disjunctions at the top of the
+    // formula, from left to right.
+    bool splitDNFs(uint32_t occurrence) {
+        const auto &root = ast[ast.NodeOf(occurrence)];
+        if (root.type == TokenType::AND_OPERATOR) {
+            dnfs.push_back(occurrence);
+            return true;
+        }
+        if (root.type != TokenType::OR_OPERATOR) {
+            return fail(ErrorCode::NOT_A_DISJUNCTION, occurrence, "expected or operator");
         }
+        std::vector<uint32_t> stack{ast.RightOccurrence(occurrence), ast.LeftOccurrence(occurrence)};
+        while (!stack.empty()) {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            const auto &node = ast[ast.NodeOf(current)];
+            if (node.type == TokenType::OR_OPERATOR) {
+                stack.push_back(ast.RightOccurrence(current));
+                stack.push_back(ast.LeftOccurrence(current));
+            } else if (node.type == TokenType::AND_OPERATOR) {
+                dnfs.push_back(current);
+            } else {
+                std::stringstream ss;
+                ss << "unexpected operator in PDNF: " << node.type;
+                return fail(ErrorCode::UNEXPECTED_OPERATOR, current, ss.str());
+            }
+        }
+        return true;
+    }
+
+    bool fail(ErrorCode code, uint32_t occurrence, std::string message) {
+        error = PdnfError{code, occurrence, std::move(message)};
+        return false;
     }
 
-    std::shared_ptr<BooleanExpression> root;
-    std::vector<std::shared_ptr<BooleanExpression>> dnfs;
+    const Ast &ast;
+    std::vector<uint32_t> dnfs;
+    std::optional<PdnfError> error;
     std::shared_ptr<SymbolTable> symbol_table;
 
 };
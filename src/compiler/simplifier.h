@@ -0,0 +1,175 @@
+//
+// Created by illfate on 5/11/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_SIMPLIFIER_H
+#define BOOLEAN_EXPRESSION_COMPILER_SIMPLIFIER_H
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "ast.h"
+
+// Simplifier rewrites a formula in its own arena into an equivalent, usually smaller one.
+// Symbols bound by let become constants, constants are folded, and double negation,
+// idempotence, complements and absorption are applied, e.g. (0/\X) -> 0, (!(!A)) -> A,
+// (X/\X) -> X, (X\/(!X)) -> 1, (X\/(X/\Y)) -> X and (X->1) -> 1. The nodes are rebuilt
+// bottom-up through the hash-consing constructors of the arena, so an unchanged
+// subformula keeps its index and the original formula stays intact.
+class Simplifier {
+public:
+    Simplifier(Ast &ast, const std::vector<std::optional<bool>> &symbol_values)
+            : ast(ast), symbol_values(symbol_values) {}
+
+    // Simplify returns the index of the simplified formula at root.
+    uint32_t Simplify(uint32_t root) {
+        std::vector<bool> reachable(root + 1);
+        std::vector<uint32_t> stack{root};
+        reachable[root] = true;
+        while (!stack.empty()) {
+            auto node = ast[stack.back()];
+            stack.pop_back();
+            if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+                continue;
+            }
+            for (uint32_t child:{node.left, node.right}) {
+                if (child != NO_NODE && !reachable[child]) {
+                    reachable[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+        // children have smaller indices than their parents, so they are simplified first
+        std::vector<uint32_t> simplified(root + 1, NO_NODE);
+        for (uint32_t index = 0; index <= root; ++index) {
+            if (!reachable[index]) {
+                continue;
+            }
+            auto node = ast[index];
+            switch (node.type) {
+                case TokenType::SYMBOL:
+                    if (node.symbol < symbol_values.size() && symbol_values[node.symbol]) {
+                        simplified[index] = ast.AddConstant(symbol_values[node.symbol].value());
+                    } else {
+                        simplified[index] = index;
+                    }
+                    break;
+                case TokenType::CONSTANT:
+                    simplified[index] = index;
+                    break;
+                case TokenType::NOT_OPERATOR:
+                    simplified[index] = makeNot(simplified[node.left]);
+                    break;
+                default:
+                    simplified[index] = makeBinary(node.type, simplified[node.left], simplified[node.right]);
+            }
+        }
+        return simplified[root];
+    }
+
+private:
+    std::optional<bool> constant(uint32_t index) const {
+        if (ast[index].type != TokenType::CONSTANT) {
+            return {};
+        }
+        return ast[index].symbol != 0;
+    }
+
+    bool isComplement(uint32_t lhs, uint32_t rhs) const {
+        return (ast[lhs].type == TokenType::NOT_OPERATOR && ast[lhs].left == rhs) ||
+               (ast[rhs].type == TokenType::NOT_OPERATOR && ast[rhs].left == lhs);
+    }
+
+    // absorbs tells whether x absorbs the operation y of type type, x is one of its operands
+    bool absorbs(uint32_t x, uint32_t y, TokenType type) const {
+        return ast[y].type == type && (ast[y].left == x || ast[y].right == x);
+    }
+
+    uint32_t makeNot(uint32_t child) {
+        if (auto value = constant(child)) {
+            return ast.AddConstant(!value.value());
+        }
+        if (ast[child].type == TokenType::NOT_OPERATOR) {
+            return ast[child].left;
+        }
+        return ast.AddNot(child);
+    }
+
+    uint32_t makeBinary(TokenType type, uint32_t left, uint32_t right) {
+        auto lhs = constant(left);
+        auto rhs = constant(right);
+        switch (type) {
+            case TokenType::AND_OPERATOR:
+                if (lhs) {
+                    return lhs.value() ? right : left;
+                }
+                if (rhs) {
+                    return rhs.value() ? left : right;
+                }
+                if (left == right || absorbs(left, right, TokenType::OR_OPERATOR)) {
+                    return left;
+                }
+                if (absorbs(right, left, TokenType::OR_OPERATOR)) {
+                    return right;
+                }
+                if (isComplement(left, right)) {
+                    return ast.AddConstant(false);
+                }
+                break;
+            case TokenType::OR_OPERATOR:
+                if (lhs) {
+                    return lhs.value() ? left : right;
+                }
+                if (rhs) {
+                    return rhs.value() ? right : left;
+                }
+                if (left == right || absorbs(left, right, TokenType::AND_OPERATOR)) {
+                    return left;
+                }
+                if (absorbs(right, left, TokenType::AND_OPERATOR)) {
+                    return right;
+                }
+                if (isComplement(left, right)) {
+                    return ast.AddConstant(true);
+                }
+                break;
+            case TokenType::IMPLICATION:
+                if (lhs) {
+                    return lhs.value() ? right : ast.AddConstant(true);
+                }
+                if (rhs) {
+                    return rhs.value() ? right : makeNot(left);
+                }
+                if (left == right) {
+                    return ast.AddConstant(true);
+                }
+                if (isComplement(left, right)) {
+                    return right;
+                }
+                break;
+            case TokenType::EQUALITY:
+                if (lhs) {
+                    return lhs.value() ? right : makeNot(right);
+                }
+                if (rhs) {
+                    return rhs.value() ? left : makeNot(left);
+                }
+                if (left == right) {
+                    return ast.AddConstant(true);
+                }
+                if (isComplement(left, right)) {
+                    return ast.AddConstant(false);
+                }
+                break;
+            default:
+                throw std::invalid_argument("unexpected node in formula");
+        }
+        return ast.AddBinary(type, left, right);
+    }
+
+    Ast &ast;
+    const std::vector<std::optional<bool>> &symbol_values;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_SIMPLIFIER_H
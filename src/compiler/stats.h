@@ -0,0 +1,272 @@
+//
+// Created by illfate on 5/13/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_STATS_H
+#define BOOLEAN_EXPRESSION_COMPILER_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+#include "ast.h"
+
+// The replacement operator new of the executable, see main.cpp, adds every allocation to
+// these counters while count_allocations is set. Without it they stay zero.
+inline std::atomic<bool> count_allocations{false};
+inline std::atomic<uint64_t> allocated_bytes{0};
+inline std::atomic<uint64_t> allocation_count{0};
+
+inline void countAllocation(size_t size) {
+    if (count_allocations.load(std::memory_order_relaxed)) {
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// peakRssBytes returns the peak resident set size of the process.
+inline uint64_t peakRssBytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// CompileStats collects the wall time of the phases of a compilation and counters about
+// the formula. A phase is timed by a Timer and reports its self time: the time of a phase
+// timed while it runs, e.g. rendering the rows a streamed evaluation hands out, is only
+// counted for the inner phase. Phases are timed on the thread that owns the stats.
+class CompileStats {
+public:
+    struct Phase {
+        std::string name;
+        double seconds = 0;
+    };
+
+    // Timer adds the time from its construction to its destruction to the phase name, times
+    // weight. It does nothing without stats, so the instrumented code pays one branch.
+    class Timer {
+    public:
+        Timer(CompileStats *stats, std::string_view name, double weight = 1)
+                : stats(stats), name(name), weight(weight) {
+            if (stats) {
+                parent = stats->running;
+                stats->running = this;
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        Timer(const Timer &) = delete;
+
+        Timer &operator=(const Timer &) = delete;
+
+        ~Timer() {
+            if (!stats) {
+                return;
+            }
+            double elapsed = weight * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats->addPhase(name, elapsed - nested);
+            if (parent) {
+                parent->nested += elapsed;
+            }
+            stats->running = parent;
+        }
+
+    private:
+        CompileStats *stats;
+        std::string_view name;
+        double weight;
+        Timer *parent = nullptr;
+        double nested = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // SampledTimer times a phase that runs in many short calls, like rendering one row of a
+    // streamed table, where a Timer per call would cost as much as the call. The first
+    // SAMPLE_INTERVAL calls are timed, then every SAMPLE_INTERVAL-th call is timed and
+    // counted for the calls up to the next sample.
+    class SampledTimer {
+    public:
+        static constexpr uint64_t SAMPLE_INTERVAL = 64;
+
+        SampledTimer(CompileStats *stats, std::string_view name) : stats(stats), name(name) {}
+
+        template<typename Call>
+        void Time(Call &&call) {
+            uint64_t index = calls++;
+            if (!stats || (index >= SAMPLE_INTERVAL && index % SAMPLE_INTERVAL != 0)) {
+                call();
+                return;
+            }
+            Timer timer(stats, name, index < SAMPLE_INTERVAL ? 1 : SAMPLE_INTERVAL);
+            call();
+        }
+
+    private:
+        CompileStats *stats;
+        std::string_view name;
+        uint64_t calls = 0;
+    };
+
+    CompileStats() : start(std::chrono::steady_clock::now()),
+                     start_bytes(allocated_bytes.load()), start_allocations(allocation_count.load()) {
+        count_allocations = true;
+    }
+
+    // CountNodes records the distinct nodes of the parsed formula at root by operator.
+    void CountNodes(const Ast &ast, uint32_t root) {
+        nodes = countNodes(ast, root);
+    }
+
+    // CountSimplifiedNodes records the number of distinct nodes of the simplified formula.
+    void CountSimplifiedNodes(const Ast &ast, uint32_t root) {
+        simplified_nodes = 0;
+        for (uint64_t count:countNodes(ast, root)) {
+            simplified_nodes += count;
+        }
+    }
+
+    const std::vector<Phase> &Phases() const {
+        return phases;
+    }
+
+    // Seconds returns the time spent in phase name so far.
+    double Seconds(std::string_view name) const {
+        for (const auto &phase:phases) {
+            if (phase.name == name) {
+                return phase.seconds;
+            }
+        }
+        return 0;
+    }
+
+    uint64_t Nodes() const {
+        uint64_t total = 0;
+        for (uint64_t count:nodes) {
+            total += count;
+        }
+        return total;
+    }
+
+    void WriteText(std::ostream &os) const {
+        os << std::fixed << std::setprecision(6);
+        os << "Phases:\n";
+        for (const auto &phase:phases) {
+            os << "  " << phase.name << ": " << phase.seconds << " s\n";
+        }
+        os << "  total: " << elapsed() << " s\n";
+        os << "Tokens: " << tokens << "\n";
+        os << "Nodes: " << Nodes();
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            os << (i == 0 ? " (" : ", ") << NODE_TYPES[i].name << " " << nodes[i];
+        }
+        os << (nodes.empty() ? "\n" : ")\n");
+        os << "Simplified nodes: " << simplified_nodes << "\n";
+        os << "Variables: " << variables << "\n";
+        os << "Bound variables: " << bound_variables << "\n";
+        os << "Rows evaluated: " << rows << "\n";
+        os << "Allocations: " << allocation_count - start_allocations << "\n";
+        os << "Bytes allocated: " << allocated_bytes - start_bytes << "\n";
+        os << "Peak RSS bytes: " << peakRssBytes() << "\n";
+        os << std::defaultfloat;
+    }
+
+    void WriteJson(std::ostream &os) const {
+        os << std::fixed << std::setprecision(6);
+        os << "{\"phases\": {";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            os << (i == 0 ? "" : ", ") << "\"" << phases[i].name << "\": " << phases[i].seconds;
+        }
+        os << "}, \"total_seconds\": " << elapsed();
+        os << ", \"tokens\": " << tokens;
+        os << ", \"nodes\": {";
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            os << (i == 0 ? "" : ", ") << "\"" << NODE_TYPES[i].name << "\": " << nodes[i];
+        }
+        os << "}, \"simplified_nodes\": " << simplified_nodes;
+        os << ", \"variables\": " << variables;
+        os << ", \"bound_variables\": " << bound_variables;
+        os << ", \"rows_evaluated\": " << rows;
+        os << ", \"allocations\": " << allocation_count - start_allocations;
+        os << ", \"bytes_allocated\": " << allocated_bytes - start_bytes;
+        os << ", \"peak_rss_bytes\": " << peakRssBytes() << "}\n";
+        os << std::defaultfloat;
+    }
+
+    uint64_t tokens = 0;
+    uint64_t simplified_nodes = 0;
+    uint64_t variables = 0;
+    uint64_t bound_variables = 0;
+    uint64_t rows = 0;
+
+private:
+    struct NodeType {
+        TokenType type;
+        const char *name;
+    };
+
+    static constexpr NodeType NODE_TYPES[] = {{TokenType::SYMBOL,         "symbol"},
+                                              {TokenType::CONSTANT,       "constant"},
+                                              {TokenType::NOT_OPERATOR,   "not"},
+                                              {TokenType::AND_OPERATOR,   "and"},
+                                              {TokenType::OR_OPERATOR,    "or"},
+                                              {TokenType::IMPLICATION,    "implication"},
+                                              {TokenType::EQUALITY,       "equality"}};
+
+    static std::vector<uint64_t> countNodes(const Ast &ast, uint32_t root) {
+        std::vector<uint64_t> counts(std::size(NODE_TYPES));
+        std::vector<bool> visited(root + 1);
+        std::vector<uint32_t> stack{root};
+        visited[root] = true;
+        while (!stack.empty()) {
+            const auto &node = ast[stack.back()];
+            stack.pop_back();
+            for (size_t i = 0; i < std::size(NODE_TYPES); ++i) {
+                if (NODE_TYPES[i].type == node.type) {
+                    ++counts[i];
+                }
+            }
+            if (node.type == TokenType::SYMBOL || node.type == TokenType::CONSTANT) {
+                continue;
+            }
+            for (uint32_t child:{node.left, node.right}) {
+                if (child != NO_NODE && !visited[child]) {
+                    visited[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+        return counts;
+    }
+
+    void addPhase(std::string_view name, double seconds) {
+        for (auto &phase:phases) {
+            if (phase.name == name) {
+                phase.seconds += seconds;
+                return;
+            }
+        }
+        phases.push_back({std::string(name), seconds});
+    }
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::chrono::steady_clock::time_point start;
+    uint64_t start_bytes;
+    uint64_t start_allocations;
+    std::vector<Phase> phases;
+    std::vector<uint64_t> nodes;
+    Timer *running = nullptr;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_STATS_H
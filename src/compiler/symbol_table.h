@@ -14,14 +14,6 @@
 class SymbolTable {
 public:
 
-    void SetToken(size_t id, const Token &token) {
-        token_table[id] = token;
-    }
-
-    std::optional<Token> GetToken(size_t id) const {
-        return token_table.at(id);
-    }
-
     void SetTokenToConst(const Token &token, const Constant &con) {
         token_to_constant.insert({token, con});
     }
@@ -30,8 +22,11 @@ public:
         return token_to_constant;
     }
 
+    void Clear() {
+        token_to_constant.clear();
+    }
+
 private:
-    std::unordered_map<size_t, Token> token_table;
     std::unordered_map<Token, Constant> token_to_constant;
 };
 
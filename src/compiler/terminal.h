@@ -26,8 +26,6 @@ public:
         value = v;
     }
 
-
-
 private:
     std::string symbol;
     bool value;
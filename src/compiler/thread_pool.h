@@ -0,0 +1,85 @@
+//
+// Created by illfate on 4/22/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_THREAD_POOL_H
+#define BOOLEAN_EXPRESSION_COMPILER_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// ThreadPool runs submitted tasks on a fixed set of worker threads. The destructor
+// finishes the queued tasks before joining the workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto &worker:workers) {
+            worker.join();
+        }
+    }
+
+    template<typename F>
+    auto Submit(F &&f) -> std::future<decltype(f())> {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock(mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        cv.notify_one();
+        return future;
+    }
+
+    size_t Size() const {
+        return workers.size();
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] { return stopped || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopped = false;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_THREAD_POOL_H
@@ -30,6 +30,9 @@ enum class TokenType {
     IDENTIFIER_OPERATOR,
     CLOSE_EXPRESSION_OPERATOR,
     CONSTANT,
+    END_OF_INPUT,
+    // ERROR is a malformed token, see Lexer::Error.
+    ERROR,
 };
 
 const std::unordered_set<TokenType> BINARY_OPERATIONS = {
@@ -43,6 +46,20 @@ bool isBinaryOperation(const TokenType &token_type) {
     return BINARY_OPERATIONS.find(token_type) != BINARY_OPERATIONS.end();
 }
 
+// tokenLength is the number of characters of a token of type token_type.
+int64_t tokenLength(TokenType token_type) {
+    switch (token_type) {
+        case TokenType::IMPLICATION:
+        case TokenType::AND_OPERATOR:
+        case TokenType::OR_OPERATOR:
+            return 2;
+        case TokenType::IDENTIFIER_OPERATOR:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
 
 std::ostream &operator<<(std::ostream &os, const TokenType &tokenType) {
     switch (tokenType) {
@@ -73,6 +90,12 @@ std::ostream &operator<<(std::ostream &os, const TokenType &tokenType) {
         case TokenType::EQUALITY:
             os << "equality";
             return os;
+        case TokenType::END_OF_INPUT:
+            os << "end of input";
+            return os;
+        case TokenType::ERROR:
+            os << "error";
+            return os;
     }
     return os;
 }
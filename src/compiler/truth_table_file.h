@@ -0,0 +1,145 @@
+//
+// Created by illfate on 4/27/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_TRUTH_TABLE_FILE_H
+#define BOOLEAN_EXPRESSION_COMPILER_TRUTH_TABLE_FILE_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "semantic_analyzer.h"
+#include "mapped_file.h"
+
+// A truth table file is laid out for mmap, all integers are little-endian:
+//
+//   TruthTableFileHeader
+//   symbol names, each terminated by '\0', in column order
+//   one byte per bound symbol with its value
+//   zero padding up to data_offset, a multiple of 64
+//   data_words 64-bit words of the packed result column, row i is bit i % 64 of word i / 64
+//
+// The input columns are implied by the row index, as in FormulaResult.
+struct TruthTableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t symbols;
+    uint32_t bound_symbols;
+    uint32_t reserved;
+    uint64_t rows;
+    uint64_t data_offset;
+    uint64_t data_words;
+};
+
+constexpr char TRUTH_TABLE_MAGIC[8] = {'B', 'E', 'C', 'T', 'T', 'B', 'L', '\0'};
+constexpr uint32_t TRUTH_TABLE_VERSION = 1;
+constexpr uint64_t TRUTH_TABLE_ALIGNMENT = 64;
+
+static_assert(sizeof(TruthTableFileHeader) == 48);
+static_assert(std::endian::native == std::endian::little, "truth table files are written in host byte order");
+
+void writeTruthTable(std::ostream &os, const SemanticAnalyzer::FormulaResult &result) {
+    std::string names;
+    for (const auto &symbol:result.symbols) {
+        names += symbol;
+        names += '\0';
+    }
+    for (bool value:result.bound_values) {
+        names += value ? '\1' : '\0';
+    }
+    uint64_t metadata_end = sizeof(TruthTableFileHeader) + names.size();
+
+    TruthTableFileHeader header{};
+    std::memcpy(header.magic, TRUTH_TABLE_MAGIC, sizeof(header.magic));
+    header.version = TRUTH_TABLE_VERSION;
+    header.symbols = result.symbols.size();
+    header.bound_symbols = result.bound_values.size();
+    header.rows = result.Rows();
+    header.data_offset = (metadata_end + TRUTH_TABLE_ALIGNMENT - 1) / TRUTH_TABLE_ALIGNMENT * TRUTH_TABLE_ALIGNMENT;
+    header.data_words = result.results.Words().size();
+
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os.write(names.data(), names.size());
+    std::string padding(header.data_offset - metadata_end, '\0');
+    os.write(padding.data(), padding.size());
+    os.write(reinterpret_cast<const char *>(result.results.Words().data()),
+             header.data_words * sizeof(uint64_t));
+    os.flush();
+    if (!os) {
+        throw std::runtime_error("can't write truth table");
+    }
+}
+
+// MappedTruthTable reads a truth table file through mmap, the result words are used in
+// place without being parsed or copied.
+class MappedTruthTable {
+public:
+    explicit MappedTruthTable(const std::string &path) : file(path) {
+        if (file.Size() < sizeof(TruthTableFileHeader)) {
+            throw std::invalid_argument("truth table file is too short");
+        }
+        std::memcpy(&header, file.Data(), sizeof(header));
+        if (std::memcmp(header.magic, TRUTH_TABLE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::invalid_argument("not a truth table file");
+        }
+        if (header.version != TRUTH_TABLE_VERSION) {
+            throw std::invalid_argument("unsupported truth table version: " + std::to_string(header.version));
+        }
+        if (header.data_offset % TRUTH_TABLE_ALIGNMENT != 0 ||
+            header.data_offset < sizeof(header) ||
+            header.data_words != wordsForRows(header.rows) ||
+            header.data_offset > file.Size() ||
+            (file.Size() - header.data_offset) / sizeof(uint64_t) < header.data_words) {
+            throw std::invalid_argument("truth table file is corrupted");
+        }
+
+        const char *cursor = file.Data() + sizeof(header);
+        const char *metadata_end = file.Data() + header.data_offset;
+        for (uint32_t i = 0; i < header.symbols; ++i) {
+            auto end = static_cast<const char *>(std::memchr(cursor, '\0', metadata_end - cursor));
+            if (!end) {
+                throw std::invalid_argument("truth table file is corrupted");
+            }
+            symbols.emplace_back(cursor, end);
+            cursor = end + 1;
+        }
+        if (header.bound_symbols > header.symbols || metadata_end - cursor < header.bound_symbols) {
+            throw std::invalid_argument("truth table file is corrupted");
+        }
+        for (uint32_t i = 0; i < header.bound_symbols; ++i) {
+            bound_values.push_back(cursor[i] != 0);
+        }
+    }
+
+    const std::vector<std::string> &Symbols() const {
+        return symbols;
+    }
+
+    const std::deque<bool> &BoundValues() const {
+        return bound_values;
+    }
+
+    uint64_t Rows() const {
+        return header.rows;
+    }
+
+    const uint64_t *Words() const {
+        return reinterpret_cast<const uint64_t *>(file.Data() + header.data_offset);
+    }
+
+    bool Result(uint64_t row) const {
+        return (Words()[row / ROWS_PER_WORD] >> (row % ROWS_PER_WORD)) & 1;
+    }
+
+private:
+    MappedFile file;
+    TruthTableFileHeader header{};
+    std::vector<std::string> symbols;
+    std::deque<bool> bound_values;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_TRUTH_TABLE_FILE_H
@@ -0,0 +1,383 @@
+//
+// Created by illfate on 5/14/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_DIFFERENTIAL_H
+#define BOOLEAN_EXPRESSION_COMPILER_DIFFERENTIAL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../compiler/compiler.h"
+#include "../compiler/formula_generator.h"
+
+struct DifferentialOptions {
+    // max_variables bounds the variables of a case; the interpreter walks the tree once per
+    // row, so the default keeps a case in the milliseconds
+    uint32_t max_variables = 10;
+    size_t max_operations = 48;
+    uint32_t max_pdnf_variables = 6;
+};
+
+// DifferentialTester checks one generated case at a time against the interpreter, which
+// evaluates the formula as written, one row at a time, with interpret(). A formula case
+// compares the tables of the bit-parallel engine (with every kernel and with threads),
+// the BDD engine, streaming, CompiledFormula with a rebinding, BatchCompiler, and the
+// answers of the SAT solver, the BDD summary, the minimizer and the normal forms. A pdnf
+// case compares the verdict of IsPDNF with pdnfOracle. A case only depends on its seed.
+class DifferentialTester {
+public:
+    explicit DifferentialTester(DifferentialOptions options = {}) : options(options) {}
+
+    // Check runs the case of seed and returns the first disagreement, if any.
+    std::optional<std::string> Check(uint64_t seed) {
+        FormulaGenerator generator(seed);
+        // the shape of the case is drawn apart from the formula
+        std::mt19937_64 choices(seed ^ 0x9e3779b97f4a7c15ULL);
+        auto draw = [&](uint64_t bound) {
+            return choices() % bound;
+        };
+        if (draw(4) == 0) {
+            uint32_t variables = 2 + draw(std::min(options.max_variables, options.max_pdnf_variables) - 1);
+            formula = generator.PdnfCandidate(variables, 1 + draw(size_t(1) << variables));
+            return checkPdnf();
+        }
+        uint32_t variables = 1 + draw(options.max_variables);
+        switch (draw(4)) {
+            case 0:
+                formula = generator.Random(variables, variables + draw(options.max_operations));
+                break;
+            case 1:
+                formula = generator.Mixed(variables, variables + draw(options.max_operations));
+                break;
+            case 2:
+                formula = generator.Deep(variables, 1 + draw(64 * options.max_operations));
+                break;
+            default:
+                formula = generator.Wide(variables, 1 + draw(8));
+        }
+        if (draw(2) == 0) {
+            formula = generator.Spaced(formula);
+        }
+        if (draw(2) == 0) {
+            formula = generator.Bindings(variables, 1 + draw(3)) + formula;
+        }
+        return checkFormula();
+    }
+
+    const std::string &Formula() const {
+        return formula;
+    }
+
+    // pdnfOracle returns the number of minterms of formula if it is in PDNF: a disjunction
+    // of conjunctions of literals, grouped any way, where every conjunction has each
+    // variable of the formula exactly once and no two conjunctions stand for the same row.
+    static std::optional<size_t> pdnfOracle(const std::string &formula) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        Parser parser(std::make_unique<Lexer>(Lexer(formula, symbol_table)), symbol_table);
+        parser.build();
+        auto root = parser.GetRoot();
+        std::vector<std::shared_ptr<BooleanExpression>> conjunctions;
+        std::vector<std::shared_ptr<BooleanExpression>> stack{root};
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if (node->getTokenType() == TokenType::OR_OPERATOR) {
+                auto operation = std::dynamic_pointer_cast<NonTerminal>(node);
+                stack.push_back(operation->GetRight());
+                stack.push_back(operation->GetLeft());
+            } else {
+                conjunctions.push_back(node);
+            }
+        }
+        std::set<std::string> variables;
+        std::vector<std::vector<std::pair<std::string, bool>>> terms;
+        for (const auto &conjunction:conjunctions) {
+            if (conjunction->getTokenType() != TokenType::AND_OPERATOR) {
+                return {};
+            }
+            std::vector<std::pair<std::string, bool>> literals;
+            std::vector<std::shared_ptr<BooleanExpression>> operands{conjunction};
+            while (!operands.empty()) {
+                auto node = operands.back();
+                operands.pop_back();
+                if (node->getTokenType() == TokenType::AND_OPERATOR) {
+                    auto operation = std::dynamic_pointer_cast<NonTerminal>(node);
+                    operands.push_back(operation->GetRight());
+                    operands.push_back(operation->GetLeft());
+                } else if (node->getTokenType() == TokenType::SYMBOL) {
+                    literals.emplace_back(node->string(), true);
+                } else if (node->getTokenType() == TokenType::NOT_OPERATOR) {
+                    auto child = std::dynamic_pointer_cast<NotOperation>(node)->GetChild();
+                    if (child->getTokenType() != TokenType::SYMBOL) {
+                        return {};
+                    }
+                    literals.emplace_back(child->string(), false);
+                } else {
+                    return {};
+                }
+            }
+            for (const auto &literal:literals) {
+                variables.insert(literal.first);
+            }
+            terms.push_back(std::move(literals));
+        }
+        std::set<std::vector<std::pair<std::string, bool>>> rows;
+        for (auto &term:terms) {
+            std::ranges::sort(term);
+            if (term.size() != variables.size()) {
+                return {};
+            }
+            for (size_t i = 1; i < term.size(); ++i) {
+                if (term[i].first == term[i - 1].first) {
+                    return {};
+                }
+            }
+            if (!rows.insert(term).second) {
+                return {};
+            }
+        }
+        return terms.size();
+    }
+
+private:
+    using Result = std::variant<SemanticAnalyzer::FormulaResult, std::string>;
+
+    std::optional<std::string> checkPdnf() {
+        auto verdict = Compiler(formula).IsPDNF();
+        auto minterms = pdnfOracle(formula);
+        if (verdict.has_value() == minterms.has_value()) {
+            return minterms ? "IsPDNF rejects a pdnf: " + verdict.value() : "IsPDNF accepts a formula not in pdnf";
+        }
+        if (!minterms) {
+            return {};
+        }
+        // a pdnf is 1 on exactly one row per minterm
+        auto table = std::get<SemanticAnalyzer::FormulaResult>(
+                Compiler(formula).CalculateFormula({.engine=Engine::INTERPRETER}));
+        if (countOnes(table) != minterms.value()) {
+            return "the pdnf has " + std::to_string(minterms.value()) + " minterms but " +
+                   std::to_string(countOnes(table)) + " rows are 1";
+        }
+        return {};
+    }
+
+    std::optional<std::string> checkFormula() {
+        auto expected_var = Compiler(formula).CalculateFormula({.engine=Engine::INTERPRETER});
+        auto expected = std::get_if<SemanticAnalyzer::FormulaResult>(&expected_var);
+        if (!expected) {
+            return "the interpreter fails: " + std::get<std::string>(expected_var);
+        }
+        std::vector<std::pair<std::string, CalculateOptions>> engines = {
+                {"bit-parallel",         {.engine=Engine::BIT_PARALLEL}},
+                {"bit-parallel scalar",  {.engine=Engine::BIT_PARALLEL, .kernel=Kernel::SCALAR}},
+                {"bit-parallel threads", {.engine=Engine::BIT_PARALLEL, .threads=4}},
+                {"bdd",                  {.engine=Engine::BDD}},
+        };
+        for (const auto &[name, options]:engines) {
+            if (auto diff = compare(name, *expected, Compiler(formula).CalculateFormula(options))) {
+                return diff;
+            }
+        }
+        if (auto diff = compare("batch", *expected, batch_compiler.CalculateFormula(formula))) {
+            return diff;
+        }
+        if (auto diff = checkStream(*expected)) {
+            return diff;
+        }
+        if (auto diff = checkCompiled(*expected)) {
+            return diff;
+        }
+        if (auto diff = checkAnswers(*expected)) {
+            return diff;
+        }
+        return checkNormalForms(*expected);
+    }
+
+    static std::optional<std::string> compare(const std::string &name, const SemanticAnalyzer::FormulaResult &expected,
+                                              const Result &result_var) {
+        auto result = std::get_if<SemanticAnalyzer::FormulaResult>(&result_var);
+        if (!result) {
+            return name + " fails: " + std::get<std::string>(result_var);
+        }
+        if (result->symbols != expected.symbols || result->bound_values != expected.bound_values) {
+            return name + " has other columns";
+        }
+        for (size_t row = 0; row < expected.Rows(); ++row) {
+            if (result->results[row] != expected.results[row]) {
+                return name + " differs on row " + std::to_string(row);
+            }
+        }
+        return {};
+    }
+
+    std::optional<std::string> checkStream(const SemanticAnalyzer::FormulaResult &expected) {
+        std::vector<std::string> symbols;
+        size_t rows = 0;
+        std::optional<std::string> diff;
+        auto err = Compiler(formula).StreamFormula([&](const std::vector<std::string> &streamed) {
+            symbols = streamed;
+        }, [&](const std::deque<bool> &row, bool result) {
+            if (!diff && rows < expected.Rows() &&
+                (row != expected.Row(rows) || result != expected.results[rows])) {
+                diff = "the stream differs on row " + std::to_string(rows);
+            }
+            ++rows;
+        });
+        if (err) {
+            return "the stream fails: " + err.value();
+        }
+        if (symbols != expected.symbols) {
+            return "the stream has other columns";
+        }
+        if (rows != expected.Rows()) {
+            return "the stream has " + std::to_string(rows) + " rows";
+        }
+        return diff;
+    }
+
+    // checkCompiled calculates the compiled formula, then flips the first binding and
+    // compares with the interpreter on the formula with the flipped let.
+    std::optional<std::string> checkCompiled(const SemanticAnalyzer::FormulaResult &expected) {
+        auto compiled_var = Compiler(formula).Compile();
+        auto compiled = std::get_if<CompiledFormula>(&compiled_var);
+        if (!compiled) {
+            return "compile fails: " + std::get<std::string>(compiled_var);
+        }
+        if (auto diff = compare("the compiled formula", expected, compiled->Calculate())) {
+            return diff;
+        }
+        auto bindings = compiled->Bindings();
+        if (bindings.empty()) {
+            return {};
+        }
+        bool value = expected.bound_values[0];
+        std::string let = "let " + bindings[0] + "=" + (value ? "1" : "0") + ";";
+        std::string rebound = formula;
+        rebound.replace(rebound.find(let), let.size(), "let " + bindings[0] + "=" + (value ? "0" : "1") + ";");
+        auto rebound_expected = Compiler(rebound).CalculateFormula({.engine=Engine::INTERPRETER});
+        compiled->Bind(bindings[0], !value);
+        return compare("the rebound compiled formula", std::get<SemanticAnalyzer::FormulaResult>(rebound_expected),
+                       compiled->Calculate());
+    }
+
+    // checkAnswers checks the rows the sat solver finds, the bdd summary and the cover of
+    // the minimizer against the table.
+    std::optional<std::string> checkAnswers(const SemanticAnalyzer::FormulaResult &expected) {
+        std::vector<std::string> variables(expected.symbols.begin() + expected.bound_values.size(),
+                                           expected.symbols.end());
+        size_t ones = countOnes(expected);
+        for (bool value:{true, false}) {
+            auto sat_var = Compiler(formula).FindRow(value);
+            auto sat = std::get_if<SemanticAnalyzer::SatResult>(&sat_var);
+            if (!sat) {
+                return "the sat solver fails: " + std::get<std::string>(sat_var);
+            }
+            bool exists = value ? ones > 0 : ones < expected.Rows();
+            if (sat->variables != variables || sat->witness.has_value() != exists) {
+                return std::string("the sat solver is wrong about a row with ") + (value ? "1" : "0");
+            }
+            if (sat->witness && expected.results[rowOf(sat->witness.value())] != value) {
+                return std::string("the sat solver finds a wrong row with ") + (value ? "1" : "0");
+            }
+        }
+
+        auto bdd_var = Compiler(formula).AnalyzeBdd();
+        auto bdd = std::get_if<SemanticAnalyzer::BddSummary>(&bdd_var);
+        if (!bdd) {
+            return "the bdd summary fails: " + std::get<std::string>(bdd_var);
+        }
+        if (bdd->models != ones || bdd->tautology != (ones == expected.Rows()) ||
+            bdd->witness.has_value() != (ones > 0) ||
+            (bdd->witness && !expected.results[rowOf(bdd->witness.value())])) {
+            return "the bdd summary is wrong";
+        }
+
+        auto cover_var = Compiler(formula).Minimize();
+        auto cover = std::get_if<Cover>(&cover_var);
+        if (!cover) {
+            return "the minimizer fails: " + std::get<std::string>(cover_var);
+        }
+        if (cover->variables != variables) {
+            return "the cover has other variables";
+        }
+        for (size_t row = 0; row < expected.Rows(); ++row) {
+            bool covered = std::ranges::any_of(cover->cubes, [&](const Cube &cube) {
+                return (row & cube.mask) == cube.bits;
+            });
+            if (covered != expected.results[row]) {
+                return "the cover differs on row " + std::to_string(row);
+            }
+        }
+        return {};
+    }
+
+    // checkNormalForms parses the perfect normal forms back and compares their tables.
+    std::optional<std::string> checkNormalForms(const SemanticAnalyzer::FormulaResult &expected) {
+        size_t variables = expected.symbols.size() - expected.bound_values.size();
+        size_t ones = countOnes(expected);
+        for (auto form:{NormalForm::PDNF, NormalForm::PCNF}) {
+            const char *name = form == NormalForm::PDNF ? "the pdnf" : "the pcnf";
+            std::stringstream ss;
+            if (auto err = Compiler(formula).StreamNormalForm(ss, form)) {
+                return std::string(name) + " fails: " + err.value();
+            }
+            size_t terms = form == NormalForm::PDNF ? ones : expected.Rows() - ones;
+            if (terms == 0 || variables == 0) {
+                // the form is a constant
+                bool constant = ss.str() == "1";
+                if (ss.str() != "0" && ss.str() != "1") {
+                    return std::string(name) + " isn't a constant";
+                }
+                for (size_t row = 0; row < expected.Rows(); ++row) {
+                    if (expected.results[row] != constant) {
+                        return std::string(name) + " differs on row " + std::to_string(row);
+                    }
+                }
+                continue;
+            }
+            auto table_var = Compiler(ss.str()).CalculateFormula({.engine=Engine::INTERPRETER});
+            auto table = std::get_if<SemanticAnalyzer::FormulaResult>(&table_var);
+            if (!table) {
+                return std::string(name) + " doesn't parse: " + std::get<std::string>(table_var);
+            }
+            std::vector<std::string> columns(expected.symbols.begin() + expected.bound_values.size(),
+                                             expected.symbols.end());
+            if (table->symbols != columns || table->results != expected.results) {
+                return std::string(name) + " has another table";
+            }
+            if (form == NormalForm::PDNF && variables >= 2 && Compiler(ss.str()).IsPDNF()) {
+                return "IsPDNF rejects the generated pdnf";
+            }
+        }
+        return {};
+    }
+
+    static size_t rowOf(const std::vector<bool> &witness) {
+        size_t row = 0;
+        for (size_t j = 0; j < witness.size(); ++j) {
+            row |= size_t(witness[j]) << j;
+        }
+        return row;
+    }
+
+    static size_t countOnes(const SemanticAnalyzer::FormulaResult &table) {
+        size_t ones = 0;
+        for (size_t row = 0; row < table.Rows(); ++row) {
+            ones += table.results[row];
+        }
+        return ones;
+    }
+
+    DifferentialOptions options;
+    std::string formula;
+    BatchCompiler batch_compiler;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_DIFFERENTIAL_H
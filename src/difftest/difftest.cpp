@@ -0,0 +1,89 @@
+//
+// Created by illfate on 5/14/21.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include "../../vendor/argparse.hpp"
+#include "differential.h"
+
+// difftest runs generated cases through DifferentialTester until the case count or the
+// time limit is reached. Case i uses the seed --seed + i, a failing case is printed with
+// the arguments that rerun it alone. The exit status is 1 if any case failed, so the tool
+// can run as a soak job.
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser cli_parser("difftest");
+    cli_parser.add_argument("--seed")
+            .help("seed of the first case").default_value(std::string("1"));
+    cli_parser.add_argument("--cases")
+            .help("number of cases, 0 runs until --duration is over").default_value(std::string("1000"));
+    cli_parser.add_argument("--duration")
+            .help("stop after this many seconds, 0 has no limit").default_value(std::string("0"));
+    cli_parser.add_argument("--max-variables")
+            .help("largest variable count of a case").default_value(std::string("10"));
+    cli_parser.add_argument("--max-operations")
+            .help("largest operation count of a random case").default_value(std::string("48"));
+    cli_parser.add_argument("--keep-going").default_value(false)
+            .help("run the remaining cases after a failure").implicit_value(true);
+    try {
+        cli_parser.parse_args(argc, argv);
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n" << cli_parser;
+        return 1;
+    }
+
+    uint64_t seed = std::stoull(cli_parser.get<std::string>("--seed"));
+    uint64_t cases = std::stoull(cli_parser.get<std::string>("--cases"));
+    double duration = std::stod(cli_parser.get<std::string>("--duration"));
+    bool keep_going = cli_parser.get<bool>("--keep-going");
+    DifferentialOptions options;
+    options.max_variables = std::stoul(cli_parser.get<std::string>("--max-variables"));
+    options.max_operations = std::stoul(cli_parser.get<std::string>("--max-operations"));
+    if (options.max_variables < 2 || options.max_variables > MAX_GENERATED_VARIABLES || options.max_operations == 0) {
+        std::cerr << "--max-variables must be between 2 and 26 and --max-operations positive\n";
+        return 1;
+    }
+    if (cases == 0 && duration <= 0) {
+        std::cerr << "--cases 0 needs a --duration\n";
+        return 1;
+    }
+
+    DifferentialTester tester(options);
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    uint64_t ran = 0;
+    uint64_t failed = 0;
+    for (uint64_t i = 0; cases == 0 || i < cases; ++i) {
+        if (duration > 0 && elapsed() >= duration) {
+            break;
+        }
+        uint64_t case_seed = seed + i;
+        std::optional<std::string> diff;
+        try {
+            diff = tester.Check(case_seed);
+        } catch (const std::exception &ex) {
+            diff = std::string("exception: ") + ex.what();
+        }
+        ++ran;
+        if (diff) {
+            ++failed;
+            std::cout << "case " << i << " failed: " << diff.value() << "\n"
+                      << "formula: " << tester.Formula() << "\n"
+                      << "rerun with: --seed " << case_seed << " --cases 1 --max-variables " << options.max_variables
+                      << " --max-operations " << options.max_operations << "\n";
+            if (!keep_going) {
+                break;
+            }
+        }
+        if (ran % 1000 == 0) {
+            std::cerr << ran << " cases, " << failed << " failed, " << elapsed() << " s\n";
+        }
+    }
+    std::cout << ran << " cases, " << failed << " failed\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+//
+// Created by illfate on 5/15/21.
+//
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// fuzz_main runs a fuzz target where libFuzzer is not available, e.g. to replay a corpus
+// or a crash with GCC: every file argument is one input and a directory stands for its
+// files. Without arguments stdin is the input.
+int main(int argc, char *argv[]) {
+    auto run = [](const std::string &input) {
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+    };
+    auto runFile = [&](const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        run(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+    };
+    if (argc == 1) {
+        run(std::string(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()));
+        return 0;
+    }
+    size_t inputs = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::filesystem::is_directory(argv[i])) {
+            for (const auto &entry:std::filesystem::directory_iterator(argv[i])) {
+                runFile(entry.path());
+                ++inputs;
+            }
+        } else {
+            runFile(argv[i]);
+            ++inputs;
+        }
+    }
+    std::cerr << "ran " << inputs << " inputs\n";
+}
@@ -0,0 +1,40 @@
+//
+// Created by illfate on 5/15/21.
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include "../compiler/lexer.h"
+
+// The lexer must read any input to its end or to an error without throwing, and agree
+// with LookupNext on every token LookupNext can classify.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    auto require = [](bool condition) {
+        if (!condition) {
+            std::abort();
+        }
+    };
+    std::string_view source(reinterpret_cast<const char *>(data), size);
+    auto symbol_table = std::make_shared<SymbolTable>();
+    Lexer lexer(source, symbol_table);
+    int64_t last_position = 0;
+    while (!lexer.IsEmpty()) {
+        TokenType looked_up = lexer.LookupNext().type;
+        auto token = lexer.GetNext();
+        if (token.type == TokenType::ERROR) {
+            require(lexer.Error().has_value() && lexer.IsEmpty());
+            require(lexer.Error()->span.position >= -1 && lexer.Error()->span.position <= int64_t(size));
+            require(!lexer.Error()->message.empty());
+            break;
+        }
+        if (looked_up != TokenType::ERROR && looked_up != TokenType::END_OF_INPUT) {
+            require(token.type == looked_up);
+        }
+        require(token.position == -1 || token.position > last_position);
+        last_position = std::max(last_position, token.position);
+        require(lexer.Tokens() <= size + 1);
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+//
+// Created by illfate on 5/15/21.
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include "../compiler/lexer.h"
+#include "../compiler/parser.h"
+#include "../compiler/semantic_analyzer.h"
+
+// Parse must answer any input with a formula or a diagnostic inside the input, without
+// throwing, and a parser reset for the same input, timed or not, must answer the same.
+// A formula that parses must get a PDNF verdict whose span is inside the input too.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    auto require = [](bool condition) {
+        if (!condition) {
+            std::abort();
+        }
+    };
+    auto inside = [&](const SourceSpan &span) {
+        if (span.position == -1) {
+            return span.length == 0;
+        }
+        return span.position >= 1 && span.length >= 1 && span.position - 1 + span.length <= int64_t(size);
+    };
+    std::string_view source(reinterpret_cast<const char *>(data), size);
+    auto symbol_table = std::make_shared<SymbolTable>();
+    Parser parser(std::make_unique<Lexer>(source, symbol_table), symbol_table);
+    auto diagnostic = parser.Parse();
+    if (diagnostic) {
+        require(inside(diagnostic->span));
+        require(!diagnostic->message.empty());
+    } else {
+        require(parser.GetAst().Root() < parser.GetAst().Size());
+        SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+        if (auto pdnf_error = analyzer.CheckPDNF()) {
+            require(inside(pdnf_error->span) && pdnf_error->span.position != -1);
+        }
+        parser.Simplify();
+        require(parser.GetAst().EvaluationRoot() < parser.GetAst().Size());
+    }
+
+    // the parser lexes ahead when it is timed, it must answer the same
+    CompileStats stats;
+    for (auto *compile_stats:{static_cast<CompileStats *>(nullptr), &stats}) {
+        symbol_table->Clear();
+        parser.Reset(source);
+        parser.SetStats(compile_stats);
+        auto again = parser.Parse();
+        require(again.has_value() == diagnostic.has_value());
+        if (again) {
+            require(again->code == diagnostic->code && again->span == diagnostic->span &&
+                    again->message == diagnostic->message);
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,26 @@
+#include <cstdlib>
+#include <new>
 #include "cli_runner.h"
 
+// The replacement allocation functions count the bytes allocated for --stats. The
+// array, nothrow and sized forms default to these.
+void *operator new(std::size_t size) {
+    countAllocation(size);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
 int main(int argc, char *argv[]) {
     CLIRunner runner(argc, argv);
-    runner.Run(std::cout);
-}
\ No newline at end of file
+    return runner.Run(std::cout);
+}
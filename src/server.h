@@ -0,0 +1,351 @@
+//
+// Created by illfate on 4/29/21.
+//
+
+#ifndef BOOLEAN_EXPRESSION_COMPILER_SERVER_H
+#define BOOLEAN_EXPRESSION_COMPILER_SERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "compiler/thread_pool.h"
+
+// SocketFd owns a socket descriptor and closes it on destruction.
+class SocketFd {
+public:
+    explicit SocketFd(int fd = -1) : fd(fd) {}
+
+    SocketFd(SocketFd &&other) noexcept: fd(std::exchange(other.fd, -1)) {}
+
+    SocketFd &operator=(SocketFd &&other) noexcept {
+        std::swap(fd, other.fd);
+        return *this;
+    }
+
+    SocketFd(const SocketFd &) = delete;
+
+    SocketFd &operator=(const SocketFd &) = delete;
+
+    ~SocketFd() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    int Get() const {
+        return fd;
+    }
+
+private:
+    int fd;
+};
+
+sockaddr_un unixSocketAddress(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("socket path is too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// writeLine sends line and its '\n' on a connected socket.
+void writeLine(int fd, std::string_view line) {
+    std::string data(line);
+    data += '\n';
+    std::string_view rest = data;
+    while (!rest.empty()) {
+        ssize_t sent = ::send(fd, rest.data(), rest.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0) {
+            throw std::runtime_error(std::string("can't write to socket: ") + std::strerror(errno));
+        }
+        rest.remove_prefix(sent);
+    }
+}
+
+// SocketLines speaks the newline-delimited protocol of the server on a connected
+// socket: ReadLine returns the next line without its '\n', or nothing at the end of
+// the stream.
+class SocketLines {
+public:
+    explicit SocketLines(int fd) : fd(fd) {}
+
+    std::optional<std::string> ReadLine() {
+        while (true) {
+            size_t end = buffer.find('\n', scanned);
+            if (end != std::string::npos) {
+                std::string line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                scanned = 0;
+                return line;
+            }
+            scanned = buffer.size();
+            char chunk[1 << 16];
+            ssize_t got = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                if (buffer.empty()) {
+                    return {};
+                }
+                return std::exchange(buffer, {});
+            }
+            buffer.append(chunk, got);
+        }
+    }
+
+    void WriteLine(std::string_view line) {
+        writeLine(fd, line);
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t scanned = 0;
+};
+
+// Server answers newline-delimited requests on a Unix domain socket: every line a
+// client sends gets the line handler returns. One thread polls the listener and the
+// connections, the requests go to a thread pool, so a worker is only held while a
+// request is answered. A connection has at most one request in flight, which keeps its
+// answers in request order.
+class Server {
+public:
+    using Handler = std::function<std::string(std::string_view request)>;
+
+    Server(const std::string &path, size_t threads, Handler handler)
+            : path(path), handler(std::move(handler)), pool(threads) {
+        auto address = unixSocketAddress(path);
+        struct stat existing{};
+        if (::lstat(path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                throw std::runtime_error("can't listen on " + path + ": the path exists and isn't a socket");
+            }
+            ::unlink(path.c_str());
+        }
+        listener = SocketFd(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (listener.Get() < 0) {
+            throw std::runtime_error(std::string("can't create socket: ") + std::strerror(errno));
+        }
+        if (::bind(listener.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(listener.Get(), SOMAXCONN) != 0) {
+            throw std::runtime_error("can't listen on " + path + ": " + std::strerror(errno));
+        }
+        bound = true;
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw std::runtime_error(std::string("can't create pipe: ") + std::strerror(errno));
+        }
+        wake_read = SocketFd(fds[0]);
+        wake_write = SocketFd(fds[1]);
+    }
+
+    ~Server() {
+        if (bound) {
+            ::unlink(path.c_str());
+        }
+    }
+
+    // Serve accepts connections and answers their requests until Stop is called.
+    void Serve() {
+        std::vector<pollfd> fds;
+        std::vector<Connection *> polled;
+        while (!stopped) {
+            fds.assign({{wake_read.Get(), POLLIN, 0}, {listener.Get(), POLLIN, 0}});
+            polled.clear();
+            for (auto &[fd, connection]:connections) {
+                if (!connection->busy && !connection->eof) {
+                    fds.push_back({fd, POLLIN, 0});
+                    polled.push_back(connection.get());
+                }
+            }
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("can't poll: ") + std::strerror(errno));
+            }
+            if (stopped) {
+                return;
+            }
+            if (fds[0].revents) {
+                drainWakeups();
+            }
+            if (fds[1].revents) {
+                accept();
+            }
+            for (size_t i = 0; i < polled.size(); ++i) {
+                if (fds[i + 2].revents) {
+                    receive(*polled[i]);
+                }
+            }
+            dispatch();
+        }
+    }
+
+    // Stop makes Serve return, the open connections are closed once the requests in
+    // flight are answered. It may be called from any thread.
+    void Stop() {
+        stopped = true;
+        wake();
+    }
+
+private:
+    struct Connection {
+        explicit Connection(int fd) : socket(fd) {}
+
+        SocketFd socket;
+        std::string buffer;
+        bool busy = false;
+        bool eof = false;
+        // failed is set by the worker that couldn't write the answer.
+        bool failed = false;
+    };
+
+    void wake() {
+        char byte = 0;
+        while (::write(wake_write.Get(), &byte, 1) < 0 && errno == EINTR) {}
+    }
+
+    // drainWakeups takes back the connections whose request was answered.
+    void drainWakeups() {
+        char bytes[256];
+        while (::read(wake_read.Get(), bytes, sizeof(bytes)) > 0) {}
+        std::vector<int> done;
+        {
+            std::lock_guard lock(mutex);
+            done.swap(answered);
+        }
+        for (int fd:done) {
+            auto &connection = *connections.at(fd);
+            connection.busy = false;
+            if (connection.failed) {
+                connections.erase(fd);
+            }
+        }
+    }
+
+    void accept() {
+        int fd = ::accept4(listener.Get(), nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) {
+                return;
+            }
+            throw std::runtime_error(std::string("can't accept: ") + std::strerror(errno));
+        }
+        connections.emplace(fd, std::make_unique<Connection>(fd));
+    }
+
+    static void receive(Connection &connection) {
+        char chunk[1 << 16];
+        ssize_t got = ::recv(connection.socket.Get(), chunk, sizeof(chunk), 0);
+        if (got < 0 && errno == EINTR) {
+            return;
+        }
+        if (got <= 0) {
+            connection.eof = true;
+            return;
+        }
+        connection.buffer.append(chunk, got);
+    }
+
+    // dispatch submits the next complete line of every idle connection, a connection at
+    // the end of its stream also gets its unterminated last line answered before it is
+    // closed.
+    void dispatch() {
+        for (auto it = connections.begin(); it != connections.end();) {
+            auto &connection = *it->second;
+            if (connection.busy) {
+                ++it;
+                continue;
+            }
+            size_t end = connection.buffer.find('\n');
+            if (end == std::string::npos && connection.eof) {
+                end = connection.buffer.empty() ? std::string::npos : connection.buffer.size();
+            }
+            if (end == std::string::npos) {
+                it = connection.eof ? connections.erase(it) : std::next(it);
+                continue;
+            }
+            std::string request = connection.buffer.substr(0, end);
+            connection.buffer.erase(0, std::min(end + 1, connection.buffer.size()));
+            connection.busy = true;
+            pool.Submit([this, &connection, request = std::move(request)] {
+                try {
+                    writeLine(connection.socket.Get(), handler(request));
+                } catch (const std::exception &) {
+                    // the client went away, the connection is dropped
+                    connection.failed = true;
+                }
+                {
+                    std::lock_guard lock(mutex);
+                    answered.push_back(connection.socket.Get());
+                }
+                wake();
+            });
+            ++it;
+        }
+    }
+
+    std::string path;
+    Handler handler;
+    SocketFd listener;
+    bool bound = false;
+    SocketFd wake_read;
+    SocketFd wake_write;
+    std::atomic<bool> stopped = false;
+    std::mutex mutex;
+    std::vector<int> answered;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    // pool is destroyed first, so the requests in flight finish before their
+    // connections close.
+    ThreadPool pool;
+};
+
+// Client sends requests to a Server and waits for the answers.
+class Client {
+public:
+    explicit Client(const std::string &path) : socket(::socket(AF_UNIX, SOCK_STREAM, 0)), lines(socket.Get()) {
+        auto address = unixSocketAddress(path);
+        if (socket.Get() < 0 ||
+            ::connect(socket.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            throw std::runtime_error("can't connect to " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    std::string Request(std::string_view request) {
+        lines.WriteLine(request);
+        auto response = lines.ReadLine();
+        if (!response) {
+            throw std::runtime_error("server closed the connection");
+        }
+        return response.value();
+    }
+
+private:
+    SocketFd socket;
+    SocketLines lines;
+};
+
+#endif //BOOLEAN_EXPRESSION_COMPILER_SERVER_H
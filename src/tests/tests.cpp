@@ -9,6 +9,12 @@
 
 #include "catch2/catch.hpp"
 #include "../compiler/compiler.h"
+#include "../compiler/truth_table_file.h"
+#include "../server.h"
+#include "../difftest/differential.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 template<typename T>
 std::ostream &operator<<(std::ostream &os, const std::optional<T> &opt) {
@@ -32,14 +38,22 @@ void AssertEqual(const T &t, const U &u, const std::string &hint = {}) {
     }
 }
 
+std::vector<std::deque<bool>> matrixOf(const SemanticAnalyzer::FormulaResult &result) {
+    std::vector<std::deque<bool>> matrix;
+    for (size_t i = 0; i < result.Rows(); ++i) {
+        matrix.push_back(result.Row(i));
+    }
+    return matrix;
+}
+
 TEST_CASE("Test formula calculation") {
     std::string formula = "let A=1; (A/\\B)";
     Compiler compiler(formula);
     auto result_var = compiler.CalculateFormula();
     auto result = std::get<SemanticAnalyzer::FormulaResult>(result_var);
     CHECK(result.symbols == std::vector<std::string>{"A", "B"});
-    CHECK(result.results == std::deque<bool>{false, true});
-    CHECK(result.matrix_values == std::vector<std::deque<bool>>{{true, false},
+    CHECK(result.results == BitVector{false, true});
+    CHECK(matrixOf(result) == std::vector<std::deque<bool>>{{true, false},
                                                                 {true, true}});
 }
 
@@ -49,8 +63,8 @@ TEST_CASE("Test repeated symbols calculation") {
     auto result_var = compiler.CalculateFormula();
     auto result = std::get<SemanticAnalyzer::FormulaResult>(result_var);
     CHECK(result.symbols == std::vector<std::string>{"A", "D"});
-    CHECK(result.results == std::deque<bool>{false, false, false, true});
-    CHECK(result.matrix_values == std::vector<std::deque<bool>>{
+    CHECK(result.results == BitVector{false, false, false, true});
+    CHECK(matrixOf(result) == std::vector<std::deque<bool>>{
             {false, false},
             {true,  false},
             {false, true},
@@ -64,13 +78,117 @@ TEST_CASE("Test repeated symbols calculation with A=0") {
     auto result_var = compiler.CalculateFormula();
     auto result = std::get<SemanticAnalyzer::FormulaResult>(result_var);
     CHECK(result.symbols == std::vector<std::string>{"A", "D"});
-    CHECK(result.results == std::deque<bool>{false, false});
-    CHECK(result.matrix_values == std::vector<std::deque<bool>>{
+    CHECK(result.results == BitVector{false, false});
+    CHECK(matrixOf(result) == std::vector<std::deque<bool>>{
             {false, false},
             {false, true},
     });
 }
 
+TEST_CASE("Test bit-parallel engine matches interpreter") {
+    auto formulas = std::vector<std::string>{
+            R"(let A=1; (A/\B))",
+            R"(((A->B)~(!C)))",
+            R"((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A)))",
+            R"(let C=0; ((A\/B)->(C~(D/\(!E)))))",
+            "1",
+    };
+    for (const auto &formula:formulas) {
+        Compiler interpreter_compiler(formula);
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(
+                interpreter_compiler.CalculateFormula({.engine=Engine::INTERPRETER}));
+        Compiler bit_parallel_compiler(formula);
+        auto result = std::get<SemanticAnalyzer::FormulaResult>(
+                bit_parallel_compiler.CalculateFormula({.engine=Engine::BIT_PARALLEL}));
+        CHECK(result.symbols == expected.symbols);
+        CHECK(result.results == expected.results);
+        CHECK(matrixOf(result) == matrixOf(expected));
+    }
+}
+
+TEST_CASE("Test bit-parallel kernels agree") {
+    // 14 free variables span several blocks and vary the high block variables.
+    std::string formula = R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~(((J~K)->L)\/(M/\(!N)))))";
+    Compiler reference_compiler(formula);
+    auto expected = std::get<SemanticAnalyzer::FormulaResult>(
+            reference_compiler.CalculateFormula({.engine=Engine::INTERPRETER}));
+    for (auto kernel:{Kernel::SCALAR, Kernel::AVX2, Kernel::AVX512}) {
+        if (!isKernelSupported(kernel)) {
+            continue;
+        }
+        Compiler compiler(formula);
+        auto result = std::get<SemanticAnalyzer::FormulaResult>(
+                compiler.CalculateFormula({.engine=Engine::BIT_PARALLEL, .kernel=kernel}));
+        CHECK(result.results == expected.results);
+    }
+}
+
+TEST_CASE("Test bytecode lowering") {
+    auto symbol_table = std::make_shared<SymbolTable>();
+    auto lexer = std::make_unique<Lexer>(Lexer(R"(let C=1; ((A/\(!B))->(C\/A)))", symbol_table));
+    auto parser = Parser(std::move(lexer), symbol_table);
+    parser.build();
+    SemanticAnalyzer analyzer(parser.GetAst(), symbol_table);
+    auto result = analyzer.CalculateFormula();
+    CHECK(result.results == BitVector{true, true, true, true});
+
+    std::stringstream os;
+    os << analyzer.CompileProgram();
+    CHECK(os.str() == "r4 = not r1\nr4 = and r0, r4\nr5 = or r3, r0\nr4 = implication r4, r5\nresult r4\n");
+}
+
+TEST_CASE("Test multithreaded evaluation") {
+    std::string formula = R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~((((J~K)->L)\/(M/\(!N)))\/(O/\P))))";
+    Compiler single_compiler(formula);
+    auto expected = std::get<SemanticAnalyzer::FormulaResult>(single_compiler.CalculateFormula());
+    for (size_t threads:{2, 3, 8}) {
+        Compiler compiler(formula);
+        auto result = std::get<SemanticAnalyzer::FormulaResult>(compiler.CalculateFormula({.threads=threads}));
+        CHECK(result.results == expected.results);
+        CHECK(result.Rows() == expected.Rows());
+    }
+}
+
+TEST_CASE("Test streaming formula calculation") {
+    std::string formula = R"(let A=1; ((A/\B)->(C\/D)))";
+    Compiler reference_compiler(formula);
+    auto expected = std::get<SemanticAnalyzer::FormulaResult>(reference_compiler.CalculateFormula());
+    for (auto engine:{Engine::INTERPRETER, Engine::BIT_PARALLEL}) {
+        Compiler compiler(formula);
+        std::vector<std::string> symbols;
+        std::vector<std::deque<bool>> rows;
+        std::deque<bool> results;
+        auto err = compiler.StreamFormula([&](const std::vector<std::string> &s) {
+            symbols = s;
+        }, [&](const std::deque<bool> &row, bool result) {
+            rows.push_back(row);
+            results.push_back(result);
+        }, {.engine=engine});
+        CHECK(!err);
+        CHECK(symbols == expected.symbols);
+        CHECK(rows == matrixOf(expected));
+        CHECK(BitVector(results.begin(), results.end()) == expected.results);
+    }
+}
+
+TEST_CASE("Test binary truth table file") {
+    Compiler compiler(R"(let A=0; ((A\/B)->(C~B)))");
+    auto result = std::get<SemanticAnalyzer::FormulaResult>(compiler.CalculateFormula());
+    auto path = std::filesystem::temp_directory_path() / "bec_truth_table_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        writeTruthTable(file, result);
+    }
+    MappedTruthTable table(path.string());
+    CHECK(table.Symbols() == result.symbols);
+    CHECK(table.BoundValues() == result.bound_values);
+    REQUIRE(table.Rows() == result.Rows());
+    for (size_t i = 0; i < table.Rows(); ++i) {
+        CHECK(table.Result(i) == result.results[i]);
+    }
+    std::filesystem::remove(path);
+}
+
 template<typename T>
 bool operator==(const std::vector<T> &lhs, const std::vector<T> &rhs) {
     if (lhs.size() != rhs.size()) {
@@ -110,6 +228,658 @@ TEST_CASE("Test parser debug") {
     REQUIRE(expected == os.str());
 }
 
+TEST_CASE("Test arena ast") {
+    auto symbol_table = std::make_shared<SymbolTable>();
+    auto lexer = std::make_unique<Lexer>(Lexer(R"(((A/\B)->((!A)~1)))", symbol_table));
+    auto parser = Parser(std::move(lexer), symbol_table);
+    parser.build();
+    const auto &ast = parser.GetAst();
+    CHECK(ast.Size() == 7); // both occurrences of A are one node
+    CHECK(ast.Symbols() == std::vector<std::string>{"A", "B"});
+    const auto &root = ast[ast.Root()];
+    CHECK(root.type == TokenType::IMPLICATION);
+    CHECK(ast[root.left].type == TokenType::AND_OPERATOR);
+    CHECK(ast[ast[root.right].left].type == TokenType::NOT_OPERATOR);
+    CHECK(ast[ast[root.right].right].type == TokenType::CONSTANT);
+    CHECK(parser.GetRoot()->string() == "IMPLICATION");
+}
+
+TEST_CASE("Test lexer over a buffer") {
+    std::string_view formula = "(A /\\ \n B) trailing";
+    auto symbol_table = std::make_shared<SymbolTable>();
+    Lexer lexer(formula.substr(0, 10), symbol_table);
+    std::vector<TokenType> types;
+    std::vector<int64_t> positions;
+    while (!lexer.IsEmpty()) {
+        auto token = lexer.GetNext();
+        types.push_back(token.type);
+        positions.push_back(token.position);
+    }
+    CHECK(types == std::vector<TokenType>{TokenType::OPEN_BRACKET, TokenType::SYMBOL, TokenType::AND_OPERATOR,
+                                          TokenType::SYMBOL, TokenType::CLOSE_BRACKET});
+    CHECK(positions == std::vector<int64_t>{1, 2, 4, 9, 10});
+
+    auto path = std::filesystem::temp_directory_path() / "bec_mapped_formula_test.txt";
+    {
+        std::ofstream file(path);
+        file << R"(let A=1; ((A\/B)~(!B)))";
+    }
+    Compiler compiler(std::make_shared<const MappedFile>(path.string()));
+    auto res_var = compiler.CalculateFormula();
+    REQUIRE(std::holds_alternative<SemanticAnalyzer::FormulaResult>(res_var));
+    auto res = std::get<SemanticAnalyzer::FormulaResult>(res_var);
+    CHECK(res.symbols == std::vector<std::string>{"A", "B"});
+    CHECK(res.results == BitVector{true, false});
+    CHECK(matrixOf(res) == std::vector<std::deque<bool>>{{true, false},
+                                                         {true, true}});
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Test batch compiler reuse") {
+    std::vector<std::string> formulas = {
+            R"(((A/\B)\/(A/\(!B))))",
+            R"(let A=1; (A/\B))",
+            R"((A/\)",
+            R"(((C->D)~(!C)))",
+            R"(let B=0; ((A/\B)\/(A/\B)))",
+            "",
+            "A",
+    };
+    BatchCompiler batch;
+    for (const auto &formula:formulas) {
+        CHECK(batch.IsPDNF(formula) == Compiler(formula).IsPDNF());
+
+        auto expected = Compiler(formula).CalculateFormula();
+        auto got = batch.CalculateFormula(formula);
+        REQUIRE(expected.index() == got.index());
+        if (auto res = std::get_if<SemanticAnalyzer::FormulaResult>(&expected)) {
+            auto got_res = std::get<SemanticAnalyzer::FormulaResult>(got);
+            CHECK(got_res.symbols == res->symbols);
+            CHECK(got_res.bound_values == res->bound_values);
+            CHECK(got_res.results == res->results);
+        } else {
+            CHECK(std::get<std::string>(got) == std::get<std::string>(expected));
+        }
+    }
+}
+
+TEST_CASE("Test compile cache") {
+    auto calculate = [](const std::string &formula, const std::shared_ptr<CompileCache> &cache) {
+        Compiler compiler(formula);
+        compiler.SetCache(cache);
+        return std::get<SemanticAnalyzer::FormulaResult>(compiler.CalculateFormula());
+    };
+    auto is_pdnf = [](const std::string &formula, const std::shared_ptr<CompileCache> &cache) {
+        Compiler compiler(formula);
+        compiler.SetCache(cache);
+        return compiler.IsPDNF();
+    };
+    auto check_same = [&](const std::string &formula, const std::shared_ptr<CompileCache> &cache) {
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        auto got = calculate(formula, cache);
+        CHECK(got.symbols == expected.symbols);
+        CHECK(got.bound_values == expected.bound_values);
+        CHECK(got.results == expected.results);
+    };
+
+    auto cache = std::make_shared<CompileCache>(CacheOptions{});
+    check_same(R"(let C=1; ((A->B)\/(!C)))", cache);
+    check_same(R"(let C=1;((A ->B)\/ (!C)))", cache);
+    CHECK(cache->Hits() == 1);
+    check_same(R"(let A=1; ((D->B)\/(!A)))", cache);
+    CHECK(cache->Hits() == 1);
+
+    // the bindings are keyed in name order, whatever the spacing
+    auto bindings = std::make_shared<CompileCache>(CacheOptions{});
+    check_same(R"(let A=1; let B=0; let C=1; let D=0; let E=1; ((A/\B)\/((C->D)~(E\/F))))", bindings);
+    check_same(R"(let A=1;let B=0;  let C=1;let D=0; let E=1;((A/\B)\/ ((C->D)~(E\/F))))", bindings);
+    check_same(R"(let  A=1; let B=0;let C=1; let D=0;   let E=1; ( (A/\B)\/((C->D) ~ (E\/F))))", bindings);
+    CHECK(bindings->Hits() == 2);
+    check_same(R"(let A=0; let B=0; let C=1; let D=0; let E=1; ((A/\B)\/((C->D)~(E\/F))))", bindings);
+    CHECK(bindings->Hits() == 2);
+
+    auto renaming = std::make_shared<CompileCache>(CacheOptions{.directory={}, .alpha_rename=true});
+    check_same(R"(((A/\(!B))->C))", renaming);
+    check_same(R"(((C/\(!A))->B))", renaming);
+    check_same(R"(((Z/\(!Y))->X))", renaming);
+    CHECK(renaming->Hits() == 2);
+    CHECK(is_pdnf(R"(((A/\A)\/(A/\B)))", renaming) == std::optional<std::string>("got repeated element: A"));
+    CHECK(is_pdnf(R"(((B/\B)\/(B/\A)))", renaming) == std::optional<std::string>("got repeated element: B"));
+    CHECK(is_pdnf(R"(((A/\B)\/(A/\(!B))))", renaming) == std::nullopt);
+    CHECK(is_pdnf(R"(((C/\D)\/(C/\(!D))))", renaming) == std::nullopt);
+    CHECK(renaming->Hits() == 3);
+
+    auto directory = std::filesystem::temp_directory_path() / "bec_compile_cache_test";
+    std::filesystem::remove_all(directory);
+    auto stored = std::make_shared<CompileCache>(CacheOptions{.directory=directory});
+    check_same(R"(((A~B)->C))", stored);
+    CHECK(is_pdnf(R"(((A/\B)\/(A/\B)))", stored) == std::optional<std::string>("got equal elementary conjunction"));
+    auto reloaded = std::make_shared<CompileCache>(CacheOptions{.directory=directory});
+    check_same(R"(((A~B)->C))", reloaded);
+    CHECK(is_pdnf(R"(((A/\B)\/(A/\B)))", reloaded) == std::optional<std::string>("got equal elementary conjunction"));
+    CHECK(reloaded->Hits() == 2);
+    CHECK(reloaded->Misses() == 0);
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Test unix socket server") {
+    auto path = (std::filesystem::temp_directory_path() / "bec_server_test.sock").string();
+    Server server(path, 2, [](std::string_view request) {
+        thread_local BatchCompiler compiler;
+        auto pdnf_err = compiler.IsPDNF(request);
+        return pdnf_err ? "not PDNF: " + pdnf_err.value() : std::string("PDNF");
+    });
+    std::thread serving([&] { server.Serve(); });
+
+    Client first(path);
+    Client second(path);
+    CHECK(first.Request(R"(((A/\B)\/(A/\(!B))))") == "PDNF");
+    CHECK(second.Request(R"(((A/\B)\/(A/\B)))") == "not PDNF: got equal elementary conjunction");
+    CHECK(first.Request("(A\\/B)") == "not PDNF: unexpected operator in PDNF: type");
+
+    server.Stop();
+    serving.join();
+}
+
+TEST_CASE("Test unix socket server with idle clients") {
+    auto path = (std::filesystem::temp_directory_path() / "bec_server_idle_test.sock").string();
+    Server server(path, 1, [](std::string_view request) {
+        return std::string(request);
+    });
+    std::thread serving([&] { server.Serve(); });
+
+    // an open connection doesn't hold the only worker
+    Client idle(path);
+    CHECK(idle.Request("first") == "first");
+    Client first(path);
+    Client second(path);
+    CHECK(first.Request("second") == "second");
+    CHECK(second.Request("third") == "third");
+    CHECK(idle.Request("fourth") == "fourth");
+
+    server.Stop();
+    serving.join();
+
+    auto file = std::filesystem::temp_directory_path() / "bec_server_regular_file";
+    std::ofstream(file) << "keep";
+    CHECK_THROWS_AS(Server(file.string(), 1, [](std::string_view request) { return std::string(request); }),
+                    std::runtime_error);
+    CHECK(std::filesystem::is_regular_file(file));
+    std::filesystem::remove(file);
+}
+
+TEST_CASE("Test deeply nested formulas") {
+    const size_t depth = 100000;
+    std::string negations;
+    std::string left_deep;
+    std::string right_deep;
+    std::string disjunctions;
+    for (size_t i = 0; i < depth; ++i) {
+        negations += "(!";
+        left_deep += "(";
+        right_deep += R"((A/\)";
+        disjunctions += R"(((A/\B)\/)";
+    }
+    negations += "A";
+    left_deep += "A";
+    right_deep += "B";
+    disjunctions += R"((A/\B))";
+    for (size_t i = 0; i < depth; ++i) {
+        negations += ")";
+        left_deep += R"(\/B))";
+        right_deep += ")";
+        disjunctions += ")";
+    }
+
+    auto res_var = Compiler(negations).CalculateFormula();
+    REQUIRE(std::holds_alternative<SemanticAnalyzer::FormulaResult>(res_var));
+    CHECK(std::get<SemanticAnalyzer::FormulaResult>(res_var).results == BitVector{false, true});
+
+    res_var = Compiler(left_deep).CalculateFormula();
+    REQUIRE(std::holds_alternative<SemanticAnalyzer::FormulaResult>(res_var));
+    CHECK(std::get<SemanticAnalyzer::FormulaResult>(res_var).results == BitVector{false, true, true, true});
+
+    res_var = Compiler(right_deep).CalculateFormula();
+    REQUIRE(std::holds_alternative<SemanticAnalyzer::FormulaResult>(res_var));
+    CHECK(std::get<SemanticAnalyzer::FormulaResult>(res_var).results == BitVector{false, false, false, true});
+
+    CHECK(Compiler(disjunctions).IsPDNF() == std::optional<std::string>("got equal elementary conjunction"));
+
+    auto symbol_table = std::make_shared<SymbolTable>();
+    auto parser = Parser(std::make_unique<Lexer>(Lexer(right_deep, symbol_table)), symbol_table);
+    parser.build();
+    CHECK(parser.GetRoot()->string() == "AND");
+}
+
+TEST_CASE("Test hash-consed ast") {
+    auto program_of = [](const std::string &formula) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        auto parser = Parser(std::make_unique<Lexer>(Lexer(formula, symbol_table)), symbol_table);
+        parser.build();
+        std::stringstream os;
+        os << SemanticAnalyzer(parser.GetAst(), symbol_table).CompileProgram();
+        return std::make_pair(parser.GetAst().Size(), os.str());
+    };
+    auto[size, program] = program_of(R"(((A\/B)/\(A\/B)))");
+    CHECK(size == 4);
+    CHECK(program == "r4 = or r0, r1\nr4 = and r4, r4\nresult r4\n");
+
+    std::tie(size, program) = program_of(R"((((A\/B)/\C)->(A\/B)))");
+    CHECK(size == 6);
+    CHECK(program == "r5 = or r0, r1\nr6 = and r5, r2\nr6 = implication r6, r5\nresult r6\n");
+
+    for (const auto &formula:{R"((((A\/B)/\C)->(A\/B)))", R"(((!(A~B))\/((!(A~B))/\(A~B))))"}) {
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(
+                Compiler(formula).CalculateFormula({.engine=Engine::INTERPRETER}));
+        auto got = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        CHECK(got.results == expected.results);
+    }
+}
+
+TEST_CASE("Test bdd engine") {
+    auto formulas = std::vector<std::string>{
+            R"(let A=1; (A/\B))",
+            R"(((A->B)~(!C)))",
+            R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~(((J~K)->L)\/(M/\(!N)))))",
+            R"(let C=0; ((A\/B)->(C~(D/\(!E)))))",
+            "1",
+    };
+    for (const auto &formula:formulas) {
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        auto result = std::get<SemanticAnalyzer::FormulaResult>(
+                Compiler(formula).CalculateFormula({.engine=Engine::BDD}));
+        CHECK(result.symbols == expected.symbols);
+        CHECK(result.results == expected.results);
+
+        std::vector<bool> streamed;
+        Compiler(formula).StreamFormula([](const auto &) {}, [&](const std::deque<bool> &, bool value) {
+            streamed.push_back(value);
+        }, {.engine=Engine::BDD});
+        CHECK(BitVector(streamed.begin(), streamed.end()) == expected.results);
+    }
+
+    auto summary = std::get<SemanticAnalyzer::BddSummary>(Compiler(R"(((A->B)/\(B->C)))").AnalyzeBdd());
+    CHECK(summary.variables == std::vector<std::string>{"A", "B", "C"});
+    CHECK(summary.models == 4);
+    CHECK_FALSE(summary.tautology);
+    REQUIRE(summary.witness);
+    auto witness = summary.witness.value();
+    CHECK(((!witness[0] || witness[1]) && (!witness[1] || witness[2])));
+
+    summary = std::get<SemanticAnalyzer::BddSummary>(Compiler(R"((A\/(!A)))").AnalyzeBdd());
+    CHECK(summary.tautology);
+    CHECK(summary.models == 2);
+    summary = std::get<SemanticAnalyzer::BddSummary>(Compiler(R"(let B=1; (A/\(!B)))").AnalyzeBdd());
+    CHECK_FALSE(summary.witness);
+    CHECK(summary.models == 0);
+
+    CHECK(std::get<bool>(Compiler(R"((A->B))").IsEquivalent(R"(((!A)\/B))")));
+    CHECK(std::get<bool>(Compiler(R"((!(A/\B)))").IsEquivalent(R"(((!B)\/(!A)))")));
+    CHECK_FALSE(std::get<bool>(Compiler(R"((A->B))").IsEquivalent(R"((B->A))")));
+    CHECK(std::get<bool>(Compiler(R"((A\/(B/\(!B))))").IsEquivalent("A")));
+    CHECK(std::holds_alternative<std::string>(Compiler(R"((A->B))").IsEquivalent("(A")));
+}
+
+TEST_CASE("Test sat solver") {
+    auto formulas = std::vector<std::string>{
+            R"(let A=1; (A/\B))",
+            R"(((A->B)~(!C)))",
+            R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~(((J~K)->L)\/(M/\(!N)))))",
+            R"(let C=0; ((A\/B)->(C~(D/\(!E)))))",
+            R"(let B=1; (A/\(!B)))",
+            R"((A\/(!A)))",
+            R"((((A\/B)/\(A\/(!B)))/\(((!A)\/B)/\((!A)\/(!B)))))",
+            "1",
+            "0",
+    };
+    for (const auto &formula:formulas) {
+        auto table = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        size_t variables = table.symbols.size() - table.bound_values.size();
+        for (bool value:{true, false}) {
+            auto result = std::get<SemanticAnalyzer::SatResult>(Compiler(formula).FindRow(value));
+            CHECK(std::equal(result.variables.begin(), result.variables.end(),
+                             table.symbols.begin() + table.bound_values.size(), table.symbols.end()));
+            bool exists = false;
+            for (size_t row = 0; row < table.Rows(); ++row) {
+                exists = exists || table.results[row] == value;
+            }
+            REQUIRE(result.witness.has_value() == exists);
+            if (exists) {
+                size_t row = 0;
+                for (size_t j = 0; j < variables; ++j) {
+                    row |= size_t(result.witness.value()[j]) << j;
+                }
+                CHECK(table.results[row] == value);
+            }
+        }
+    }
+
+    // 7 pigeons do not fit in 6 holes, which takes clause learning to refute
+    SatSolver solver;
+    const uint32_t pigeons = 7, holes = 6;
+    for (uint32_t v = 0; v < pigeons * holes; ++v) {
+        solver.NewVariable();
+    }
+    for (uint32_t p = 0; p < pigeons; ++p) {
+        std::vector<Literal> clause;
+        for (uint32_t h = 0; h < holes; ++h) {
+            clause.push_back(makeLiteral(p * holes + h));
+        }
+        solver.AddClause(clause);
+    }
+    for (uint32_t h = 0; h < holes; ++h) {
+        for (uint32_t p = 0; p < pigeons; ++p) {
+            for (uint32_t q = p + 1; q < pigeons; ++q) {
+                solver.AddClause({makeLiteral(p * holes + h, true), makeLiteral(q * holes + h, true)});
+            }
+        }
+    }
+    CHECK_FALSE(solver.Solve());
+    CHECK(solver.Conflicts() > 0);
+}
+
+TEST_CASE("Test minimizer") {
+    auto minimized = [](const std::string &formula) {
+        return std::get<Cover>(Compiler(formula).Minimize()).Formula();
+    };
+    CHECK(minimized(R"(((A/\B)\/(A/\(!B))))") == "A");
+    CHECK(minimized(R"((((A/\B)\/(A/\C))\/((B/\C)\/((A/\B)/\C))))") == R"((((A/\B)\/(A/\C))\/(B/\C)))");
+    CHECK(minimized(R"((A->B))") == R"(((!A)\/B))");
+    CHECK(minimized(R"((A\/(!A)))") == "1");
+    CHECK(minimized(R"((A/\(!A)))") == "0");
+    CHECK(minimized(R"(let B=1; (A/\B))") == "A");
+
+    // the truth table and the bdd paths agree with the formula they came from
+    for (const auto &formula:{
+            R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~(((J~K)->L)\/(M/\(!N)))))",
+            R"((((A~B)\/(C/\D))->((E\/F)/\(!G))))",
+            R"(((((((((((((A\/B)/\(C\/D))/\(E\/F))/\(G\/H))/\(I\/J))/\(K\/L))/\(M\/N))/\(O\/P))/\Q)\/R)\/S)\/T))"}) {
+        auto cover = std::get<Cover>(Compiler(formula).Minimize());
+        CHECK(std::get<bool>(Compiler(formula).IsEquivalent(cover.Formula())));
+    }
+    auto cover = std::get<Cover>(Compiler(
+            R"(((((((((((((A\/B)/\(C\/D))/\(E\/F))/\(G\/H))/\(I\/J))/\(K\/L))/\(M\/N))/\(O\/P))/\Q)\/R)\/S)\/T))").Minimize());
+    CHECK(cover.cubes.size() == 259);
+}
+
+TEST_CASE("Test normal form generation") {
+    auto normal_form = [](const std::string &formula, NormalForm form) {
+        std::stringstream os;
+        CHECK_FALSE(Compiler(formula).StreamNormalForm(os, form));
+        return os.str();
+    };
+    CHECK(normal_form(R"((A->B))", NormalForm::PDNF) ==
+          R"((((!A)/\(!B))\/(((!A)/\B)\/(A/\B))))");
+    CHECK(normal_form(R"((A->B))", NormalForm::PCNF) == R"(((!A)\/B))");
+    CHECK(normal_form(R"((A/\(!A)))", NormalForm::PDNF) == "0");
+    CHECK(normal_form(R"((A\/(!A)))", NormalForm::PCNF) == "1");
+    CHECK(normal_form("1", NormalForm::PDNF) == "1");
+    CHECK(normal_form(R"(let A=1; (A/\B))", NormalForm::PDNF) == "B");
+
+    for (const auto &formula:{
+            R"(((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~(((J~K)->L)\/(M/\(!N)))))",
+            R"(let C=0; ((A\/B)->(C~(D/\(!E)))))",
+            R"((A~B))"}) {
+        auto pdnf = normal_form(formula, NormalForm::PDNF);
+        CHECK_FALSE(Compiler(pdnf).IsPDNF());
+        CHECK(std::get<bool>(Compiler(formula).IsEquivalent(pdnf)));
+        CHECK(std::get<bool>(Compiler(formula).IsEquivalent(normal_form(formula, NormalForm::PCNF))));
+    }
+}
+
+TEST_CASE("Test incremental rebinding") {
+    std::string body = R"(((((A/\B)\/(C->D))~((!E)/\F))\/(G->((!H)/\(A\/C)))))";
+    auto compiled = std::get<CompiledFormula>(Compiler("let A=1; let G=0; " + body).Compile());
+    auto bindings = compiled.Bindings();
+    REQUIRE(bindings.size() == 2);
+    CHECK(std::ranges::find(bindings, "A") != bindings.end());
+    CHECK_THROWS(compiled.Bind("B", true));
+
+    auto expect = [&](bool a, bool g) {
+        std::string formula = "let A=" + std::to_string(a) + "; let G=" + std::to_string(g) + "; " + body;
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        compiled.Bind("A", a);
+        compiled.Bind("G", g);
+        auto result = compiled.Calculate();
+        CHECK(result.results == expected.results);
+        CHECK(matrixOf(result) == matrixOf(expected));
+    };
+    expect(true, false);
+    size_t nodes = compiled.Recomputed();
+    expect(true, false);
+    CHECK(compiled.Recomputed() == 0);
+    expect(true, true);
+    // only G, the implication and the root depend on G
+    CHECK(compiled.Recomputed() == 3);
+    expect(false, true);
+    CHECK(compiled.Recomputed() > 3);
+    CHECK(compiled.Recomputed() < nodes);
+    expect(false, false);
+
+    // a symbol bound twice is rebound where it is evaluated
+    std::string rebound = R"(let A=1; let A=0; (A\/B))";
+    auto repeated = std::get<CompiledFormula>(Compiler(rebound).Compile());
+    auto expected = std::get<SemanticAnalyzer::FormulaResult>(Compiler(rebound).CalculateFormula());
+    CHECK(repeated.Calculate().results == expected.results);
+    repeated.Bind("A", false);
+    CHECK(repeated.Calculate().results == BitVector{false, true});
+    repeated.Bind("A", true);
+    CHECK(repeated.Calculate().results == BitVector{true, true});
+
+    auto constant = std::get<CompiledFormula>(Compiler("(A->A)").Compile());
+    CHECK(constant.Bindings().empty());
+    CHECK(constant.Calculate().results == BitVector{true, true});
+}
+
+TEST_CASE("Test simplifier") {
+    auto evaluated = [](const std::string &formula) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        auto parser = Parser(std::make_unique<Lexer>(Lexer(formula, symbol_table)), symbol_table);
+        parser.build();
+        parser.Simplify();
+        const auto &ast = parser.GetAst();
+        return ast.ToExpression(ast.EvaluationRoot())->string();
+    };
+    CHECK(evaluated(R"(let A=0; (A/\(B\/C)))") == "0");
+    CHECK(evaluated(R"((!(!A)))") == "A");
+    CHECK(evaluated(R"(((A\/B)/\A))") == "A");
+    CHECK(evaluated(R"((B->1))") == "1");
+    CHECK(evaluated(R"(((A/\B)\/(A/\B)))") == evaluated(R"((A/\B))"));
+    CHECK(evaluated(R"((C\/(!C)))") == "1");
+    CHECK(evaluated(R"(let X=1; ((X/\A)~(!(!B))))") == evaluated(R"((A~B))"));
+
+    // the table keeps every column, also of the symbols the simplified formula lost
+    for (const auto &formula:{
+            R"(((A/\(!A))\/(B/\C)))",
+            R"(let B=0; ((((((A/\B)\/(C->D))~((!E)/\F))\/(G->(!H)))/\(I\/A))~((J->1)/\(!(!K)))))",
+            R"((((A\/B)/\A)~(H/\(H\/G))))",
+            R"((G\/(!G)))",
+            R"(let A=1; (A\/B))"}) {
+        auto expected = std::get<SemanticAnalyzer::FormulaResult>(
+                Compiler(formula).CalculateFormula({.engine=Engine::INTERPRETER}));
+        auto result = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula());
+        CHECK(result.symbols == expected.symbols);
+        CHECK(matrixOf(result) == matrixOf(expected));
+        result = std::get<SemanticAnalyzer::FormulaResult>(Compiler(formula).CalculateFormula({.engine=Engine::BDD}));
+        CHECK(matrixOf(result) == matrixOf(expected));
+    }
+    // the structural checks still see the formula as written
+    CHECK(Compiler(R"((A/\(!A)))").IsPDNF() == "got repeated element: A");
+}
+
+TEST_CASE("Test compile stats") {
+    auto stats = std::make_shared<CompileStats>();
+    Compiler compiler(R"(let B=1; ((A/\B)\/(!C)))");
+    compiler.SetStats(stats);
+    REQUIRE(std::holds_alternative<SemanticAnalyzer::FormulaResult>(compiler.CalculateFormula()));
+    std::vector<std::string> phases;
+    for (const auto &phase:stats->Phases()) {
+        phases.push_back(phase.name);
+        CHECK(phase.seconds >= 0);
+    }
+    CHECK(phases == std::vector<std::string>{"lex", "parse", "simplify", "evaluate"});
+    CHECK(stats->tokens == 17);
+    CHECK(stats->Nodes() == 6);
+    CHECK(stats->simplified_nodes == 4);
+    CHECK(stats->variables == 2);
+    CHECK(stats->bound_variables == 1);
+    CHECK(stats->rows == 4);
+
+    // a phase timed inside another one is only counted for the inner phase
+    {
+        CompileStats::Timer outer(stats.get(), "outer");
+        CompileStats::Timer inner(stats.get(), "inner");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(stats->Seconds("inner") >= 0.02);
+    CHECK(stats->Seconds("outer") < stats->Seconds("inner"));
+
+    // lexing ahead for the lex phase does not change what the parser sees
+    for (std::string formula:{"( ", "(A/\\B) \n", "(A-B)", "(A)", "((A/\\B)\\/((!A)/\\(!B)))"}) {
+        Compiler timed(formula);
+        timed.SetStats(std::make_shared<CompileStats>());
+        CHECK(timed.IsPDNF() == Compiler(formula).IsPDNF());
+    }
+
+    // past the first calls only every SAMPLE_INTERVAL-th call is timed, for the calls up to
+    // the next sample
+    CompileStats::SampledTimer sampled(stats.get(), "sampled");
+    for (uint64_t call = 0; call < 2 * CompileStats::SampledTimer::SAMPLE_INTERVAL; ++call) {
+        sampled.Time([&] {
+            if (call == CompileStats::SampledTimer::SAMPLE_INTERVAL) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    CHECK(stats->Seconds("sampled") >= 0.001 * CompileStats::SampledTimer::SAMPLE_INTERVAL);
+
+    std::stringstream json;
+    stats->WriteJson(json);
+    CHECK(json.str().starts_with(R"({"phases": {"lex": )"));
+    CHECK(json.str().find(R"("nodes": {"symbol": 3, "constant": 0, "not": 1, "and": 1, "or": 1, "implication": 0, "equality": 0})") !=
+          std::string::npos);
+    CHECK(json.str().find(R"("rows_evaluated": 4)") != std::string::npos);
+    std::stringstream text;
+    stats->WriteText(text);
+    CHECK(text.str().find("Nodes: 6 (symbol 3, constant 0, not 1, and 1, or 1, implication 0, equality 0)\n") !=
+          std::string::npos);
+
+    // without stats nothing is timed
+    CompileStats::Timer timer(nullptr, "unused");
+}
+
+TEST_CASE("Test malformed input diagnostics") {
+    auto parse = [](const std::string &formula) {
+        auto symbol_table = std::make_shared<SymbolTable>();
+        Parser parser(std::make_unique<Lexer>(Lexer(formula, symbol_table)), symbol_table);
+        return parser.Parse();
+    };
+    auto check = [&](const std::string &formula, ErrorCode code, int64_t position, const std::string &message) {
+        auto diagnostic = parse(formula);
+        REQUIRE(diagnostic.has_value());
+        CHECK(diagnostic->code == code);
+        CHECK(diagnostic->span.position == position);
+        CHECK(diagnostic->message == message);
+    };
+    check("(A-B)", ErrorCode::INCOMPLETE_OPERATOR, 3, "expected -> at position 3");
+    check("(A/B)", ErrorCode::INCOMPLETE_OPERATOR, 3, "expected /\\ at position 3");
+    check("(A\\B)", ErrorCode::INCOMPLETE_OPERATOR, 3, "expected \\/ at position 3");
+    check("lex A=1; A", ErrorCode::INCOMPLETE_OPERATOR, 1, "expected let at position 1");
+    check("letA=1; A", ErrorCode::INCOMPLETE_OPERATOR, 1, "expected let at position 1");
+    check("(A#B)", ErrorCode::UNSUPPORTED_CHARACTER, 3, "unsupported type: # at position 3");
+    check("(A/\\", ErrorCode::UNEXPECTED_EOF, -1, "unexpected type");
+    check(" ", ErrorCode::UNEXPECTED_EOF, 1, "unexpected eof");
+    check("(A)", ErrorCode::UNEXPECTED_TOKEN, 3,
+          "unexpected type: got: token type: close bracket, at position: 3, with value: ), but want a binary operator\n");
+    check("(A/\\B)A", ErrorCode::TRAILING_INPUT, 7,
+          "syntax error in your formula, unexpected identifier: token type: type, at position: 7, with value: A");
+    CHECK_FALSE(parse("(A/\\B) \n").has_value());
+
+    auto symbol_table = std::make_shared<SymbolTable>();
+    Lexer lexer("(A-", symbol_table);
+    CHECK(lexer.GetNext().type == TokenType::OPEN_BRACKET);
+    CHECK(lexer.GetNext().type == TokenType::SYMBOL);
+    CHECK(lexer.LookupNext().type == TokenType::ERROR);
+    CHECK(lexer.GetNext().type == TokenType::ERROR);
+    CHECK(lexer.IsEmpty());
+    CHECK(lexer.Error()->code == ErrorCode::INCOMPLETE_OPERATOR);
+
+    auto res_var = Compiler("(A-B)").CalculateFormula();
+    REQUIRE(std::holds_alternative<std::string>(res_var));
+    CHECK(std::get<std::string>(res_var) == "expected -> at position 3");
+}
+
+TEST_CASE("Test structured diagnostics") {
+    auto check = [](const std::string &formula, ErrorCode code, SourceSpan span) {
+        auto diagnostic = Compiler(formula).CheckPDNF();
+        REQUIRE(diagnostic.has_value());
+        CHECK(diagnostic->code == code);
+        CHECK(diagnostic->span == span);
+        CHECK(Compiler(formula).IsPDNF() == diagnostic->message);
+    };
+    check(R"((A->B))", ErrorCode::NOT_A_DISJUNCTION, {1, 6});
+    check(R"(((A/\B)\/(A->B)))", ErrorCode::UNEXPECTED_OPERATOR, {10, 6});
+    check(R"(((A/\B)\/(A/\1)))", ErrorCode::NOT_A_LITERAL, {14, 1});
+    check(R"(((A/\B)\/(A/\(!A))))", ErrorCode::REPEATED_VARIABLE, {10, 9});
+    check(R"(((A/\B) \/ (B/\A)))", ErrorCode::REPEATED_CONJUNCTION, {12, 6});
+    check(R"(((A/\B)\/(A/\C)))", ErrorCode::DIFFERENT_VARIABLES, {10, 6});
+    check(R"((A->))", ErrorCode::UNEXPECTED_TOKEN, {5, 1});
+    check(R"((A/\B)\/C)", ErrorCode::TRAILING_INPUT, {7, 2});
+    CHECK_FALSE(Compiler(R"(((A/\B)\/(A/\(!B))))").CheckPDNF().has_value());
+
+    // a shared node is located where it occurs at fault, not where it occurs first
+    auto duplicate = Compiler(R"(((A/\B)\/(A/\B)))").CheckPDNF();
+    REQUIRE(duplicate.has_value());
+    CHECK(duplicate->code == ErrorCode::REPEATED_CONJUNCTION);
+    CHECK(duplicate->span.position == 10);
+    auto misplaced = Compiler(R"(((A/\B)\/A))").CheckPDNF();
+    REQUIRE(misplaced.has_value());
+    CHECK(misplaced->code == ErrorCode::UNEXPECTED_OPERATOR);
+    CHECK(misplaced->span.position == 10);
+
+    auto result = Compiler(R"((A\/B))").Calculate();
+    REQUIRE(result.has_value());
+    CHECK(result->Rows() == 4);
+    auto rejected = Compiler("(A-B)").Calculate();
+    REQUIRE_FALSE(rejected.has_value());
+    CHECK(rejected.error().code == ErrorCode::INCOMPLETE_OPERATOR);
+    CHECK(rejected.error().span == SourceSpan{3, 1});
+
+    // a cached verdict is located in the formula at hand
+    auto cache = std::make_shared<CompileCache>(CacheOptions{});
+    BatchCompiler batch;
+    batch.SetCache(cache);
+    CHECK(batch.CheckPDNF(R"(((A/\B)\/(A/\C)))")->span == SourceSpan{10, 6});
+    auto cached = batch.CheckPDNF(R"(  ((A/\B)\/(A/\C)))");
+    CHECK(cache->Hits() == 1);
+    REQUIRE(cached.has_value());
+    CHECK(cached->code == ErrorCode::DIFFERENT_VARIABLES);
+    CHECK(cached->span == SourceSpan{12, 6});
+    CHECK(batch.Calculate("(A/\\").error().code == ErrorCode::UNEXPECTED_EOF);
+}
+
+TEST_CASE("Test differential engines") {
+    CHECK(DifferentialTester::pdnfOracle(R"(((A/\B)\/((!A)/\B)))") == 2);
+    CHECK(DifferentialTester::pdnfOracle(R"((A/\(!B)))") == 1);
+    CHECK_FALSE(DifferentialTester::pdnfOracle(R"(((A/\B)\/(B/\A)))"));
+    CHECK_FALSE(DifferentialTester::pdnfOracle(R"(((A/\B)\/(!A)))"));
+    CHECK_FALSE(DifferentialTester::pdnfOracle(R"(((A/\A)\/(A/\B)))"));
+    CHECK_FALSE(DifferentialTester::pdnfOracle(R"((A\/B))"));
+
+    FormulaGenerator generator(3);
+    CHECK(generator.Bindings(4, 2).starts_with("let "));
+    CHECK(Compiler(generator.Spaced(generator.Mixed(6, 30))).CalculateFormula().index() == 0);
+
+    DifferentialTester tester({.max_variables=8, .max_operations=24});
+    for (uint64_t seed = 0; seed < 100; ++seed) {
+        auto diff = tester.Check(seed);
+        CHECK(diff == std::nullopt);
+        if (diff) {
+            std::cerr << tester.Formula() << "\n";
+        }
+    }
+}
+
 TEST_CASE("test compiler") {
     auto test_cases = std::vector<std::pair<std::string, std::optional<std::string>>>{
             {R"((((((!A)/\B)/\(!C))\/(A/\((!B)/\(!C))))\/((B/\(!A))/\(!C))))",         {"got equal elementary conjunction"}},
@@ -133,6 +903,9 @@ TEST_CASE("test compiler") {
             {"(A/\\B)",                                                                {}},
             {"(A/\\(!B))",                                                             {}},
             {"(A/\\(!A))",                                                             "got repeated element: A"},
+            {R"(((A/\C)\/(B/\C)))",                                                   "got not equal vars in conjunctions"},
+            {R"((((A/\A)/\A)\/(A/\B)))",                                               "got repeated element: AA"},
+            {R"((((A/\B)\/((!A)/\B))\/(((!A)/\(!B))\/(A/\(!B)))))",                     {}},
     };
     std::ranges::for_each(test_cases, [&](auto pair) {
         auto str = std::string(pair.first);